@@ -0,0 +1,192 @@
+#include "./affinity.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// bits in a node mask, as set_mempolicy() and migrate_pages() count them: they
+// take one more than the number of bits they are to look at
+#define NODE_BITS (sizeof(unsigned long) * 8)
+
+/*
+ * parses a list such as "0-3,6" into set, where no number may be max or more
+ * returns 0 on success, -1 if the list is empty or malformed
+ */
+static int parse_list(const char *list, cpu_set_t *set, unsigned long max) {
+    CPU_ZERO(set);
+    const char *p = list;
+    do {
+        char *end;
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+        unsigned long first = strtoul(p, &end, 10), last = first;
+        if (*end == '-') {
+            p = end + 1;
+            if (*p < '0' || *p > '9') {
+                return -1;
+            }
+            last = strtoul(p, &end, 10);
+        }
+        if (first > last || last >= max) {
+            return -1;
+        }
+        for (unsigned long n = first; n <= last; n++) {
+            CPU_SET(n, set);
+        }
+        p = end;
+    } while (*p++ == ',');
+    return p[-1] == '\0' ? 0 : -1;
+}
+
+/*
+ * sets a placement from the way pin takes it: cpus is a CPU list such as
+ * "0-3,6", and nodes a NUMA node list in the same form, NULL for none
+ * returns 0 on success, -1 if cpus is bad, -2 if nodes is bad
+ */
+int set_placement(placement_t *placement, const char *cpus, const char *nodes) {
+    if (parse_list(cpus, &placement->cpus, CPU_SETSIZE) < 0) {
+        return -1;
+    }
+    placement->pinned = 1;
+    placement->mem_nodes = 0;
+    if (nodes != NULL) {
+        cpu_set_t set;
+        if (parse_list(nodes, &set, NODE_BITS) < 0) {
+            return -2;
+        }
+        for (unsigned long n = 0; n < NODE_BITS; n++) {
+            if (CPU_ISSET(n, &set)) {
+                placement->mem_nodes |= 1UL << n;
+            }
+        }
+    }
+    return 0;
+}
+
+/* the NUMA nodes the system has online, as a mask; just node 0 if unknown */
+static unsigned long online_nodes(void) {
+    char buf[256];
+    cpu_set_t set;
+    unsigned long nodes = 0;
+    int fd = open("/sys/devices/system/node/online", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return 1;
+    }
+    buf[n] = '\0';
+    if (buf[n - 1] == '\n') {
+        buf[n - 1] = '\0';
+    }
+    if (parse_list(buf, &set, NODE_BITS) < 0) {
+        return 1;
+    }
+    for (unsigned long i = 0; i < NODE_BITS; i++) {
+        if (CPU_ISSET(i, &set)) {
+            nodes |= 1UL << i;
+        }
+    }
+    return nodes;
+}
+
+/*
+ * moves a running process to a placement: every one of its threads is pinned
+ * to its CPUs, and its pages are migrated to its NUMA nodes, once, with
+ * migrate_pages(); unlike a launch, this sets no MPOL_BIND policy, so pages it
+ * allocates later go wherever its own policy puts them
+ * returns 0 on success, -1 on failure (with errno set)
+ */
+int pin_process(pid_t pid, const placement_t *placement) {
+    if (placement->pinned) {
+        // affinity is per thread, so each of the process's is pinned
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+        DIR *tasks = opendir(path);
+        if (tasks == NULL) {
+            return -1;
+        }
+        struct dirent *task;
+        while ((task = readdir(tasks)) != NULL) {
+            pid_t tid = (pid_t)strtol(task->d_name, NULL, 10);
+            if (tid > 0 &&
+                sched_setaffinity(tid, sizeof(cpu_set_t), &placement->cpus) <
+                    0 &&
+                errno != ESRCH) {
+                int err = errno;
+                closedir(tasks);
+                errno = err;
+                return -1;
+            }
+        }
+        closedir(tasks);
+    }
+    if (placement->mem_nodes != 0) {
+        unsigned long from = online_nodes();
+        if (syscall(SYS_migrate_pages, pid, NODE_BITS + 1, &from,
+                    &placement->mem_nodes) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * moves every process in process group pgid to a placement, as pin_process()
+ * does, finding them by the group in field 5 of each /proc/<pid>/stat: that
+ * takes in whatever the job's members have forked since, not just the members
+ * returns 0 on success, -1 on failure (with errno set, and *failed set to the
+ * process that could not be moved, 0 if /proc could not be read); the rest of
+ * the group is still moved
+ */
+int pin_group(pid_t pgid, const placement_t *placement, pid_t *failed) {
+    DIR *procs = opendir("/proc");
+    if (procs == NULL) {
+        *failed = 0;
+        return -1;
+    }
+    int ret = 0, err = 0;
+    struct dirent *proc;
+    while ((proc = readdir(procs)) != NULL) {
+        pid_t pid = (pid_t)strtol(proc->d_name, NULL, 10);
+        if (pid <= 0) {
+            continue;
+        }
+        // the command name in parentheses may hold anything, so the fields
+        // are counted from the last ')'
+        char path[32], stat[512];
+        snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;  // it has exited
+        }
+        ssize_t n = read(fd, stat, sizeof(stat) - 1);
+        close(fd);
+        if (n <= 0) {
+            continue;
+        }
+        stat[n] = '\0';
+        char *fields = strrchr(stat, ')');
+        int pgrp;
+        if (fields == NULL || sscanf(fields + 1, " %*c %*d %d", &pgrp) != 1 ||
+            pgrp != pgid) {
+            continue;
+        }
+        if (pin_process(pid, placement) < 0 && errno != ENOENT &&
+            errno != ESRCH) {
+            err = errno;
+            *failed = pid;
+            ret = -1;
+        }
+    }
+    closedir(procs);
+    errno = err;
+    return ret;
+}
@@ -0,0 +1,44 @@
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+#include <sched.h>
+#include <sys/types.h>
+
+/*
+ * where a job runs: on the CPUs in cpus if pinned is set, and with its memory
+ * bound to the NUMA nodes in mem_nodes (a bit per node), 0 for no binding
+ * an unset placement is all zeros
+ */
+typedef struct {
+    cpu_set_t cpus;
+    int pinned;
+    unsigned long mem_nodes;
+} placement_t;
+
+/*
+ * sets a placement from the way pin takes it: cpus is a CPU list such as
+ * "0-3,6", and nodes a NUMA node list in the same form, NULL for none
+ * returns 0 on success, -1 if cpus is bad, -2 if nodes is bad
+ */
+int set_placement(placement_t *placement, const char *cpus, const char *nodes);
+
+/*
+ * moves a running process to a placement: every one of its threads is pinned
+ * to its CPUs, and its pages are migrated to its NUMA nodes, once, with
+ * migrate_pages(); unlike a launch, this sets no MPOL_BIND policy, so pages it
+ * allocates later go wherever its own policy puts them
+ * returns 0 on success, -1 on failure (with errno set)
+ */
+int pin_process(pid_t pid, const placement_t *placement);
+
+/*
+ * moves every process in process group pgid to a placement, as pin_process()
+ * does, finding them by the group in field 5 of each /proc/<pid>/stat: that
+ * takes in whatever the job's members have forked since, not just the members
+ * returns 0 on success, -1 on failure (with errno set, and *failed set to the
+ * process that could not be moved, 0 if /proc could not be read); the rest of
+ * the group is still moved
+ */
+int pin_group(pid_t pgid, const placement_t *placement, pid_t *failed);
+
+#endif  // AFFINITY_H_
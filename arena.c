@@ -0,0 +1,139 @@
+#include "./arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// a type as strictly aligned as any other
+typedef union {
+    long double ld;
+    long long ll;
+    void *p;
+    void (*f)(void);
+} arena_align_t;
+
+// every allocation is rounded up to this, so that any type can go in it
+#define ARENA_ALIGN __alignof__(arena_align_t)
+
+// a block of memory allocations are carved out of; data holds size bytes
+struct chunk {
+    struct chunk *next;
+    size_t size;
+    arena_align_t data[];
+};
+typedef struct chunk chunk_t;
+
+// chunks is the list of every chunk, in the order they were needed
+// current is the chunk being allocated from, and used how much of it is gone
+// allocs and mallocs count allocations since the last reset, and how many of
+// them had to add a chunk
+struct arena {
+    chunk_t *chunks;
+    chunk_t *current;
+    size_t used;
+    size_t allocs;
+    size_t mallocs;
+};
+
+/* allocates a chunk holding size bytes, returns pointer, NULL on failure */
+static chunk_t *new_chunk(size_t size) {
+    chunk_t *chunk = (chunk_t *)malloc(sizeof(chunk_t) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    return chunk;
+}
+
+/* initializes an arena whose first chunk holds size bytes, returns pointer,
+ * NULL on failure */
+arena_t *init_arena(size_t size) {
+    arena_t *arena = (arena_t *)malloc(sizeof(arena_t));
+    if (arena == NULL) {
+        return NULL;
+    }
+    if ((arena->chunks = new_chunk(size)) == NULL) {
+        free(arena);
+        return NULL;
+    }
+    arena->current = arena->chunks;
+    arena->used = 0;
+    arena->allocs = 0;
+    arena->mallocs = 0;
+    return arena;
+}
+
+/*
+ * cleans up arena, freeing everything allocated from it
+ * Note: this function will free the arena pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_arena(arena_t *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    chunk_t *cur = arena->chunks;
+    while (cur != NULL) {
+        chunk_t *next = cur->next;
+        free(cur);
+        cur = next;
+    }
+    free(arena);
+}
+
+/*
+ * allocates size bytes from the arena, aligned for any type, returns pointer,
+ * NULL on failure
+ * memory is only given back all at once, by reset_arena()
+ * malloc() is only called when no chunk the arena already has is big enough
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena->allocs++;
+    // move on to the next chunk, adding one twice as big (or big enough) when
+    // there are no more
+    while (arena->current->size - arena->used < size) {
+        if (arena->current->next == NULL || arena->current->next->size < size) {
+            size_t grown = arena->current->size * 2;
+            chunk_t *chunk = new_chunk(grown > size ? grown : size);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            // the new chunk goes in front of any next one that was too small,
+            // which is still used once the new one fills up
+            chunk->next = arena->current->next;
+            arena->current->next = chunk;
+            arena->mallocs++;
+        }
+        arena->current = arena->current->next;
+        arena->used = 0;
+    }
+    void *p = (char *)arena->current->data + arena->used;
+    arena->used += size;
+    return p;
+}
+
+/*
+ * frees everything allocated from the arena in O(1), keeping its chunks for
+ * the allocations that follow
+ * with ARENA_STATS defined, also prints how many allocations were made since
+ * the last reset, and how many of them had to call malloc()
+ */
+void reset_arena(arena_t *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+#ifdef ARENA_STATS
+    fprintf(stderr, "arena: %zu allocations, %zu mallocs\n", arena->allocs,
+            arena->mallocs);
+#endif
+    arena->current = arena->chunks;
+    arena->used = 0;
+    arena->allocs = 0;
+    arena->mallocs = 0;
+}
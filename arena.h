@@ -0,0 +1,34 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+typedef struct arena arena_t;
+
+/* initializes an arena whose first chunk holds size bytes, returns pointer,
+ * NULL on failure */
+arena_t *init_arena(size_t size);
+/*
+ * cleans up arena, freeing everything allocated from it
+ * Note: this function will free the arena pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_arena(arena_t *arena);
+
+/*
+ * allocates size bytes from the arena, aligned for any type, returns pointer,
+ * NULL on failure
+ * memory is only given back all at once, by reset_arena()
+ * malloc() is only called when no chunk the arena already has is big enough
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/*
+ * frees everything allocated from the arena in O(1), keeping its chunks for
+ * the allocations that follow
+ * with ARENA_STATS defined, also prints how many allocations were made since
+ * the last reset, and how many of them had to call malloc()
+ */
+void reset_arena(arena_t *arena);
+
+#endif  // ARENA_H_
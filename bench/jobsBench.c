@@ -0,0 +1,103 @@
+/*
+ * jobsBench - measures the job table with many jobs in it: adding jobs,
+ * looking them up by JID and by PID, updating their state (as the reaper does)
+ * and removing them
+ *
+ * Usage: jobsBench [jobs] [build]
+ *
+ * Results are printed as lines of JSON (see report.h), one per operation,
+ * labelled with build ("debug" if not given). The
+ * PIDs are made up; every job is removed before the table is cleaned up, so
+ * nothing is ever signalled.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "../jobs.h"
+#include "./report.h"
+
+// operations timed together in one sample
+#define BATCH 64
+
+// made up PIDs, far from any the benchmark's own processes could have
+#define FIRST_PID 1000000
+
+/* the PID of the i-th job, spread out the way real PIDs are */
+static pid_t pid_of(int i) { return FIRST_PID + i * 7; }
+
+int main(int argc, char **argv) {
+    int njobs = argc > 1 ? atoi(argv[1]) : 100000;
+    const char *build = argc > 2 ? argv[2] : "debug";
+    njobs = njobs / BATCH * BATCH;
+    if (njobs == 0) njobs = BATCH;
+    size_t nsamples = (size_t)(njobs / BATCH);
+    double *samples = malloc(sizeof(double) * nsamples);
+    job_list_t *job_list = init_job_list();
+    char command[] = "/bin/sleep";
+    if (samples == NULL || job_list == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    for (size_t s = 0; s < nsamples; s++) {
+        double start = now_ns();
+        for (int i = (int)s * BATCH; i < (int)(s + 1) * BATCH; i++) {
+            add_job(job_list, i + 1, pid_of(i), RUNNING, command);
+        }
+        samples[s] = now_ns() - start;
+    }
+    report("jobs", build, "add_job", samples, nsamples, BATCH);
+
+    // lookups go in a scattered order rather than the one jobs were added in
+    for (size_t s = 0; s < nsamples; s++) {
+        double start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            int jid = (int)((s * BATCH + (size_t)i) * 7919 % (size_t)njobs) + 1;
+            if (get_job_pid(job_list, jid) != pid_of(jid - 1)) {
+                fprintf(stderr, "job %d not found\n", jid);
+                return 1;
+            }
+        }
+        samples[s] = now_ns() - start;
+    }
+    report("jobs", build, "get_job_pid", samples, nsamples, BATCH);
+
+    for (size_t s = 0; s < nsamples; s++) {
+        double start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            int j = (int)((s * BATCH + (size_t)i) * 7919 % (size_t)njobs);
+            if (get_job_jid(job_list, pid_of(j)) != j + 1) {
+                fprintf(stderr, "pid %d not found\n", pid_of(j));
+                return 1;
+            }
+        }
+        samples[s] = now_ns() - start;
+    }
+    report("jobs", build, "get_job_jid", samples, nsamples, BATCH);
+
+    for (size_t s = 0; s < nsamples; s++) {
+        double start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            int j = (int)((s * BATCH + (size_t)i) * 7919 % (size_t)njobs);
+            update_job_pid(job_list, pid_of(j), i % 2 ? RUNNING : STOPPED);
+        }
+        samples[s] = now_ns() - start;
+    }
+    report("jobs", build, "update_job_pid", samples, nsamples, BATCH);
+
+    for (size_t s = 0; s < nsamples; s++) {
+        double start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            int j = (int)((s * BATCH + (size_t)i) * 7919 % (size_t)njobs);
+            if (remove_job_pid(job_list, pid_of(j)) != 0) {
+                fprintf(stderr, "pid %d not removed\n", pid_of(j));
+                return 1;
+            }
+        }
+        samples[s] = now_ns() - start;
+    }
+    report("jobs", build, "remove_job_pid", samples, nsamples, BATCH);
+
+    cleanup_job_list(job_list);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * parseBench - measures how fast command lines are lexed and parsed, the way
+ * the shell's main loop does it: the arena is reset, the line is lexed, and
+ * each command of it is split into a parsed pipeline
+ *
+ * Usage: parseBench [lines] [build]
+ *
+ * Results are printed as lines of JSON (see report.h), one per kind of line,
+ * labelled with build ("debug" if not given).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../arena.h"
+#include "./report.h"
+
+// the parser is one of the shell's helpers, which are compiled into sh.c
+#include "../parsing.c"
+
+// lines timed together in one sample
+#define BATCH 64
+
+// kinds of command line, from a bare command to a long pipeline
+static const struct {
+    const char *op;
+    const char *line;
+} corpus[] = {
+    {"simple", "/bin/ls -l"},
+    {"redirects", "< in /bin/cat -n > out 2>&1"},
+    {"quoted", "/bin/echo 'a b c' \"d \\\"e\\\" f\" g\\ h"},
+    {"pipeline", "/bin/cat file | /bin/grep -v x | /bin/sort | /bin/uniq -c"},
+    {"sequence",
+     "/bin/echo one; /bin/echo two & /bin/sleep 1 & /bin/echo three > f"},
+    {"long",
+     "/usr/bin/gcc -g3 -Wall -Wextra -Wconversion -Wcast-qual -Wcast-align "
+     "-Winline -Wfloat-equal -Wnested-externs -pedantic -std=gnu99 -Werror "
+     "-D_GNU_SOURCE sh.c jobs.c spawn.c pathcache.c linereader.c events.c "
+     "dirstack.c arena.c -o 33sh"},
+};
+
+/* lexes and parses line (a copy of it, since lexing works in place) once */
+static void parse_line(const char *line, char *buffer, size_t len,
+                       arena_t *arena) {
+    token_t *tokens;
+    stage_t *stages;
+    reset_arena(arena);
+    memcpy(buffer, line, len + 1);
+    int n = lex(buffer, &tokens, arena);
+    for (int start = 0, end; start < n; start = end + 1) {
+        end = commandEnd(tokens, n, start);
+        if (parsePipeline(tokens + start, end - start, &stages, arena) < 0) {
+            fprintf(stderr, "parse failed: %s\n", line);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int lines = argc > 1 ? atoi(argv[1]) : 200000;
+    const char *build = argc > 2 ? argv[2] : "debug";
+    size_t nsamples = (size_t)(lines / BATCH > 0 ? lines / BATCH : 1);
+    double *samples = malloc(sizeof(double) * nsamples);
+    arena_t *arena = init_arena(4096);
+    char buffer[1024];
+    if (samples == NULL || arena == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    for (size_t c = 0; c < sizeof(corpus) / sizeof(corpus[0]); c++) {
+        size_t len = strlen(corpus[c].line);
+        // one untimed round so the arena has grown to fit
+        parse_line(corpus[c].line, buffer, len, arena);
+        for (size_t s = 0; s < nsamples; s++) {
+            double start = now_ns();
+            for (int i = 0; i < BATCH; i++) {
+                parse_line(corpus[c].line, buffer, len, arena);
+            }
+            samples[s] = now_ns() - start;
+        }
+        report("parse", build, corpus[c].op, samples, nsamples, BATCH);
+    }
+    cleanup_arena(arena);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "./report.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* orders samples for qsort() */
+static int compare_samples(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * prints one result as a line of JSON, so that runs can be compared by a
+ * script:
+ * {"bench": ..., "build": ..., "op": ..., "ops": ..., "ops_per_sec": ...,
+ *  "p50_ns": ..., "p90_ns": ..., "p99_ns": ...}
+ * build tells apart results of the same benchmark built different ways
+ * samples holds nsamples timings in nanoseconds, each of ops_per_sample ops;
+ * it is sorted in place
+ */
+void report(const char *bench, const char *build, const char *op,
+            double *samples, size_t nsamples, size_t ops_per_sample) {
+    double total = 0;
+    for (size_t i = 0; i < nsamples; i++) {
+        total += samples[i];
+    }
+    qsort(samples, nsamples, sizeof(double), compare_samples);
+    // percentiles are of the time per op
+    double per = (double)ops_per_sample;
+    size_t ops = nsamples * ops_per_sample;
+    printf(
+        "{\"bench\": \"%s\", \"build\": \"%s\", \"op\": \"%s\", "
+        "\"ops\": %zu, "
+        "\"ops_per_sec\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, "
+        "\"p99_ns\": %.1f}\n",
+        bench, build, op, ops, total > 0 ? (double)ops / (total / 1e9) : 0.0,
+        samples[nsamples / 2] / per, samples[nsamples * 9 / 10] / per,
+        samples[nsamples * 99 / 100] / per);
+    fflush(stdout);
+}
+
+/* nanoseconds on the monotonic clock, for taking samples */
+double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,21 @@
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#include <stddef.h>
+
+/*
+ * prints one result as a line of JSON, so that runs can be compared by a
+ * script:
+ * {"bench": ..., "build": ..., "op": ..., "ops": ..., "ops_per_sec": ...,
+ *  "p50_ns": ..., "p90_ns": ..., "p99_ns": ...}
+ * build tells apart results of the same benchmark built different ways
+ * samples holds nsamples timings in nanoseconds, each of ops_per_sample ops;
+ * it is sorted in place
+ */
+void report(const char *bench, const char *build, const char *op,
+            double *samples, size_t nsamples, size_t ops_per_sample);
+
+/* nanoseconds on the monotonic clock, for taking samples */
+double now_ns(void);
+
+#endif  // REPORT_H_
@@ -0,0 +1,132 @@
+/*
+ * shellBench - measures commands per second through the whole shell: a
+ * scripted workload is piped into the shell (33noprompt), which reads, parses
+ * and runs every command, launching and reaping its jobs, until end of input
+ *
+ * Usage: shellBench shell programs [commands] [runs]
+ *
+ * shell is the shell to run and programs the directory with the test
+ * programs (myspin, delayed_echo and exit_status, from shell_2_tests). Each
+ * workload of commands lines is run runs times; the percentiles are of the
+ * time per command of each run. Results are printed as lines of JSON (see
+ * report.h), one per workload, labelled with the shell's file name as the
+ * build.
+ */
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "./report.h"
+
+// what each line of a workload is; %s is the programs directory
+static const struct {
+    const char *op;
+    const char *line;
+} workloads[] = {
+    // the shell alone: builtins, with nothing launched
+    {"builtin", "cd .\n"},
+    {"exit_status", "%s/exit_status 0 3\n"},
+    {"delayed_echo", "%s/delayed_echo 0 hello > /dev/null\n"},
+    // launched and reaped at the next prompt
+    {"background", "%s/myspin 0 &\n"},
+    {"pipeline", "%s/delayed_echo 0 hello | %s/exit_status 0 0\n"},
+};
+
+/* writes all of buf to fd, returns 0 on success, -1 on failure */
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* runs shell on script, returns how long it took in nanoseconds */
+static double run_shell(const char *shell, const char *script, size_t len) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    double start = now_ns();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(pipefd[0], STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(null);
+        execl(shell, shell, (char *)NULL);
+        perror(shell);
+        _exit(1);
+    }
+    close(pipefd[0]);
+    if (write_all(pipefd[1], script, len) < 0) {
+        perror("write");
+        exit(1);
+    }
+    close(pipefd[1]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s did not exit cleanly\n", shell);
+        exit(1);
+    }
+    return now_ns() - start;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s shell programs [commands] [runs]\n",
+                argv[0]);
+        return 1;
+    }
+    const char *shell = argv[1];
+    const char *programs = argv[2];
+    const char *build = basename(argv[1]);
+    int commands = argc > 3 ? atoi(argv[3]) : 500;
+    size_t runs = argc > 4 ? (size_t)atol(argv[4]) : 20;
+    double *samples = malloc(sizeof(double) * runs);
+    if (samples == NULL || commands < 1 || runs < 1) {
+        fprintf(stderr, "bad commands or runs\n");
+        return 1;
+    }
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        char line[4096];
+        int n =
+            snprintf(line, sizeof(line), workloads[w].line, programs, programs);
+        if (n < 0 || (size_t)n >= sizeof(line)) {
+            fprintf(stderr, "programs path too long\n");
+            return 1;
+        }
+        size_t len = (size_t)n * (size_t)commands;
+        char *script = malloc(len);
+        if (script == NULL) {
+            perror("malloc");
+            return 1;
+        }
+        for (int i = 0; i < commands; i++) {
+            memcpy(script + (size_t)i * (size_t)n, line, (size_t)n);
+        }
+        run_shell(shell, script, len);  // warm up the page cache
+        for (size_t r = 0; r < runs; r++) {
+            samples[r] = run_shell(shell, script, len);
+        }
+        report("shell", build, workloads[w].op, samples, runs,
+               (size_t)commands);
+        free(script);
+    }
+    free(samples);
+    return 0;
+}
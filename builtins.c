@@ -0,0 +1,860 @@
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "./affinity.h"
+#include "./arena.h"
+#include "./dirstack.h"
+#include "./history.h"
+#include "./jobs.h"
+#include "./linereader.h"
+#include "./pathcache.h"
+#include "./rlimits.h"
+#include "./vars.h"
+
+// Everything of the shell's a builtin can act on. jid is the JID the next job
+// will get, rlimits the limits every job is launched with, input the shell's
+// stdin if it reads its commands from there (NULL if from a script), status
+// the exit status of the last job waited for, in the foreground or with wait
+// (which $? expands to), history the history,
+// NULL if none is kept, and vars the shell's variables
+typedef struct {
+    job_list_t *job_list;
+    path_cache_t *path_cache;
+    dir_stack_t *dir_stack;
+    arena_t *arena;
+    int jid;
+    rlimits_t rlimits;
+    line_reader_t *input;
+    int status;
+    history_t *history;
+    var_store_t *vars;
+} shell_t;
+
+// A builtin: its name, the function that runs it once its syntax has been
+// checked, how many words it takes (counting its name) and any other syntax
+// rule it has, NULL for none
+typedef struct {
+    const char *name;
+    void (*run)(shell_t *shell, char **argv, int argc);
+    int minArgs;
+    int maxArgs;
+    syntax_rule_t rule;
+} builtin_t;
+
+// builtin command: exit
+static void runExit(shell_t *shell, char **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    cleanup_job_list(shell->job_list);
+    exit(0);
+}
+
+// Copies the PWD and OLDPWD the directory stack keeps in the environment into
+// the shell's variables, exported, after the current directory has changed
+static void syncDirVars(shell_t *shell) {
+    const char *dirs[] = {"PWD", "OLDPWD"};
+    for (int i = 0; i < 2; i++) {
+        const char *dir = getenv(dirs[i]);
+        if (dir != NULL && set_var(shell->vars, dirs[i], dir, 1) < 0) {
+            perror("Error setting variable");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+}
+
+// builtin command: cd
+static void runCd(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    int r = change_dir(shell->dir_stack, argv[1]);
+    if (r != 0) {
+        if ((r == 1 ? fprintf(stderr, "%s: OLDPWD not set\n", argv[0])
+                    : fprintf(stderr, "%s: %s.\n", argv[0], strerror(errno))) <
+            0) {
+            perror("Error printing no such file or directory error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        return;
+    }
+    syncDirVars(shell);
+}
+
+// builtin command: pushd
+static void runPushd(shell_t *shell, char **argv, int argc) {
+    int r = push_dir(shell->dir_stack, argc == 2 ? argv[1] : NULL);
+    if (r != 0) {
+        if ((r == 1 ? fprintf(stderr, "%s: no other directory\n", argv[0])
+                    : fprintf(stderr, "%s: %s.\n", argv[0], strerror(errno))) <
+            0) {
+            perror("Error printing pushd error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        return;
+    }
+    syncDirVars(shell);
+    print_dir_stack(shell->dir_stack);
+}
+
+// builtin command: popd
+static void runPopd(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    int r = pop_dir(shell->dir_stack);
+    if (r != 0) {
+        if ((r == 1 ? fprintf(stderr, "%s: directory stack empty\n", argv[0])
+                    : fprintf(stderr, "%s: %s.\n", argv[0], strerror(errno))) <
+            0) {
+            perror("Error printing popd error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        return;
+    }
+    syncDirVars(shell);
+    print_dir_stack(shell->dir_stack);
+}
+
+// builtin command: dirs
+static void runDirs(shell_t *shell, char **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    print_dir_stack(shell->dir_stack);
+}
+
+// builtin command: ln
+static void runLn(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    size_t l2 = strlen(argv[2]);
+    if (l2 > 0 && argv[2][l2 - 1] == '/') argv[1][l2 - 1] = '\0';
+    if (link(argv[1], argv[2]) < 0) {
+        if (fprintf(stderr, "%s: No such file or directory.\n", argv[0]) < 0) {
+            perror("Error printing no such file or directory error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+}
+
+// builtin command: rm
+static void runRm(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    if (unlink(argv[1]) < 0) {
+        if (fprintf(stderr, "%s: No such file or directory.\n", argv[0]) < 0) {
+            perror("Error printing no such file or directory error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+}
+
+// builtin command: jobs
+static void runJobs(shell_t *shell, char **argv, int argc) {
+    (void)argv;
+    if (argc == 2)
+        jobs_long(shell->job_list);
+    else
+        jobs(shell->job_list);
+}
+
+// builtin command: hash
+static void runHash(shell_t *shell, char **argv, int argc) {
+    (void)argv;
+    if (argc == 2)
+        clear_path_cache(shell->path_cache);
+    else
+        print_path_cache(shell->path_cache);
+}
+
+// builtin command: ulimit
+static void runUlimit(shell_t *shell, char **argv, int argc) {
+    if (argc == 1) {
+        if (print_rlimits(&shell->rlimits) < 0) {
+            perror("Error printing limits");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        return;
+    }
+    for (int i = 1; i < argc; i += 2) {
+        set_rlimit(&shell->rlimits, argv[i], argv[i + 1]);
+    }
+}
+
+// Works out whether the command in tokens[start, end) has a ulimit prefix:
+// ulimit, options with their limits, then a command to launch with them. If
+// so, the limits are added to rlimits. Returns how many tokens the prefix
+// takes, 0 if there is none (so a ulimit is the builtin), -1 (having printed
+// why) if a limit is bad
+int ulimitPrefix(token_t *tokens, int start, int end, rlimits_t *rlimits,
+                 job_list_t *job_list) {
+    if (start == end || tokens[start].type != TOKEN_WORD ||
+        strcmp(tokens[start].start, "ulimit") != 0)
+        return 0;
+    int i = start + 1;
+    while (i + 1 < end && tokens[i].type == TOKEN_WORD &&
+           tokens[i].start[0] == '-' &&
+           (tokens[i + 1].type == TOKEN_WORD ||
+            tokens[i + 1].type == TOKEN_QUOTED))
+        i += 2;
+    if (i == end ||
+        (tokens[i].type != TOKEN_WORD && tokens[i].type != TOKEN_QUOTED) ||
+        tokens[i].start[0] == '-')
+        return 0;
+    for (int j = start + 1; j < i; j += 2) {
+        if (addLimit(tokens[start].start, tokens[j].start, tokens[j + 1].start,
+                     rlimits, job_list) == -1)
+            return -1;
+    }
+    return i - start;
+}
+
+// builtin command: pin
+// Every process in the job's process group is moved, found through /proc, so
+// that children its members have forked since go with them
+static void runPin(shell_t *shell, char **argv, int argc) {
+    int jid = (int)strtol(argv[1] + 1, NULL, 10);
+    placement_t placement;
+    pid_t failed;
+    set_placement(&placement, argv[2], argc == 5 ? argv[4] : NULL);
+    if (pin_group(get_job_pgid(shell->job_list, jid), &placement, &failed) <
+        0) {
+        if (fprintf(stderr, "%s: (%d): %s\n", argv[0],
+                    failed ? failed : get_job_pid(shell->job_list, jid),
+                    strerror(errno)) < 0) {
+            perror("Error printing pin error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+}
+
+// Works out whether the command in tokens[start, end) has a pin prefix: pin,
+// a CPU list, optionally --mem and a node list, then a command to launch in
+// that placement, which it is set to. Returns how many tokens the prefix
+// takes, 0 if there is none (so a pin is the builtin), -1 (having printed why)
+// if a list is bad
+int pinPrefix(token_t *tokens, int start, int end, placement_t *placement,
+              job_list_t *job_list) {
+    if (end - start < 3 || tokens[start].type != TOKEN_WORD ||
+        strcmp(tokens[start].start, "pin") != 0 ||
+        tokens[start + 1].type != TOKEN_WORD ||
+        tokens[start + 1].start[0] == '%')
+        return 0;
+    int i = start + 2;
+    char *nodes = NULL;
+    if (tokens[i].type == TOKEN_WORD && strcmp(tokens[i].start, "--mem") == 0) {
+        if (i + 2 >= end || tokens[i + 1].type != TOKEN_WORD) return 0;
+        nodes = tokens[i + 1].start;
+        i += 2;
+    }
+    if (tokens[i].type != TOKEN_WORD && tokens[i].type != TOKEN_QUOTED)
+        return 0;
+    if (addPlacement(tokens[start].start, tokens[start + 1].start, nodes,
+                     placement, job_list) == -1)
+        return -1;
+    return i - start;
+}
+
+// A slot of parallel's worker pool: whether a job is running in it, the
+// argument it was run with (its own copy), whether any of its processes has
+// failed so far, and whether one was interrupted (killed by SIGINT). A job
+// whose processes have all been suspended leaves its slot stopped, with the
+// signal that suspended the last in stopsig. The job in slot i has JID
+// first + i, first being the JID the shell's next job would get, so the pool
+// only takes a JID for good when it leaves a stopped job on the job list
+typedef struct {
+    int busy;
+    char *arg;
+    int failed;
+    int interrupted;
+    int stopped;
+    int stopsig;
+} pool_slot_t;
+
+// Copies s to p, with a backslash before every character the lexer could take
+// for something other than part of a word. Returns where the copy ends
+static char *escapeWord(char *p, const char *s) {
+    for (; *s; s++) {
+        if (!isalnum((unsigned char)*s) && !strchr("_./-+=:,@%{}", *s))
+            *p++ = '\\';
+        *p++ = *s;
+    }
+    return p;
+}
+
+// Launches the template words, with arg in place of every {} in them (or after
+// them if there is none), as job jid, into process group group (0 for a new
+// one). It is launched in the background, since the shell may still read
+// arguments from the terminal; waitParallel() hands the terminal over. The line
+// is put together and lexed and parsed again: a template of a single word is a
+// command line of its own, so it can have redirects and pipes (quoted, so they
+// were not the shell's), while the words of a longer template, and arg always,
+// are escaped so that each stays exactly one word whatever it holds. Only the
+// first command of the line is run. Returns 0 if the job was launched, -1 if
+// not
+static int launchParallel(shell_t *shell, char **words, int nwords,
+                          const char *arg, int jid, pid_t group,
+                          arena_t *arena) {
+    size_t arglen = strlen(arg), size = 2 * arglen + 2;
+    int placed = 0;  // whether any word has a {}
+    for (int i = 0; i < nwords; i++) {
+        size += 2 * strlen(words[i]) + 1;
+        for (char *b = strstr(words[i], "{}"); b; b = strstr(b + 2, "{}")) {
+            size += 2 * arglen;
+            placed = 1;
+        }
+    }
+    char *line = arena_alloc(arena, size), *p = line;
+    token_t *tokens;
+    stage_t *stages;
+    placement_t anywhere;
+    if (line == NULL) return -1;
+    for (int i = 0; i < nwords; i++) {
+        for (char *w = words[i], *b; *w; w = b + 2) {
+            if ((b = strstr(w, "{}")) != NULL) *b = '\0';
+            if (nwords == 1) {
+                p = stpcpy(p, w);
+            } else {
+                p = escapeWord(p, w);
+            }
+            if (b == NULL) break;
+            *b = '{';
+            p = escapeWord(p, arg);
+        }
+        *p++ = ' ';
+    }
+    if (!placed) p = escapeWord(p, arg);
+    *p = '\0';
+    int n = lex(line, &tokens, arena), end;
+    if (n <= 0) return -1;
+    end = commandEnd(tokens, n, 0);
+    if (expandWords(&tokens, n, 0, &end, shell->vars, shell->status, arena) ==
+        -2)
+        return -1;
+    int nstages = parsePipeline(tokens, end, &stages, arena);
+    if (nstages <= 0) return -1;
+    for (int i = 0; i < nstages; i++) {
+        if (stages[i].redirects[0] != -1 &&
+            redirectsErrorChecker(&stages[i], shell->job_list) == -1)
+            return -1;
+    }
+    memset(&anywhere, 0, sizeof(anywhere));
+    return launchPipeline(stages, nstages, 1, group, &shell->rlimits, &anywhere,
+                          get_envp(shell->vars), jid, shell->job_list,
+                          shell->path_cache, arena);
+}
+
+// Waits until at least one of the jobs in the pool has finished or been
+// suspended, with the terminal handed to the pool's process group, group, so
+// that ^C and ^Z reach every job in it as they would a job in the foreground,
+// then hands it back to the shell. Each
+// process is reaped through its pidfd the way waitForeground does, so that no
+// other child is touched (those are left to childReaper). A pidfd only becomes
+// readable once its process exits, so a process being suspended is noticed
+// through sigfd, a signalfd for SIGCHLD. A job whose processes are all
+// suspended is reported, and stays on the job list, stopped. A process counts
+// as failed if it does not exit with status 0. Returns the number of jobs that
+// finished or were suspended, whose slots are now free
+static int waitParallel(shell_t *shell, pool_slot_t *pool, int nslots,
+                        int first, pid_t group, int sigfd) {
+    int finished = 0;
+    tcsetpgrp(STDIN_FILENO, group);
+    while (finished == 0) {
+        struct pollfd *fds;
+        struct signalfd_siginfo chld;
+        int nfds = 1, timeout = -1, pidfd;
+        for (int s = 0; s < nslots; s++) {
+            if (pool[s].busy)
+                nfds += count_job_members(shell->job_list, first + s, RUNNING) +
+                        count_job_members(shell->job_list, first + s, STOPPED);
+        }
+        if ((fds = malloc(sizeof(struct pollfd) * (size_t)nfds)) == NULL) {
+            perror("Error allocating parallel");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        fds[0].fd = sigfd;
+        fds[0].events = POLLIN;
+        nfds = 1;
+        for (int s = 0; s < nslots; s++) {
+            for (int i = 0;
+                 pool[s].busy &&
+                 get_job_member(shell->job_list, first + s, i, &pidfd) != -1;
+                 i++) {
+                // without a pidfd, the process is checked on every 10ms
+                if (pidfd < 0) timeout = 10;
+                fds[nfds].fd = pidfd;
+                fds[nfds++].events = POLLIN;
+            }
+        }
+        if (poll(fds, (nfds_t)nfds, timeout) < 0 && errno != EINTR) {
+            perror("Error polling parallel");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        free(fds);
+        while (read(sigfd, &chld, sizeof(chld)) > 0) {
+            // whatever child it was for is checked on below
+        }
+        for (int s = 0; s < nslots; s++) {
+            pid_t pid;
+            siginfo_t info;
+            struct rusage usage;
+            for (int i = 0; pool[s].busy &&
+                            (pid = get_job_member(shell->job_list, first + s, i,
+                                                  &pidfd)) != -1;) {
+                info.si_pid = 0;
+                if ((pidfd >= 0
+                         ? waitUsage(P_PIDFD, (id_t)pidfd, &info,
+                                     WEXITED | WSTOPPED | WNOHANG, &usage)
+                         : waitUsage(P_PID, (id_t)pid, &info,
+                                     WEXITED | WSTOPPED | WNOHANG, &usage)) <
+                        0 ||
+                    info.si_pid == 0) {
+                    i++;
+                    continue;
+                }
+                if (info.si_code == CLD_STOPPED ||
+                    info.si_code == CLD_TRAPPED) {
+                    update_job_member(shell->job_list, pid, STOPPED);
+                    pool[s].stopsig = info.si_status;
+                    i++;
+                    continue;
+                }
+                if (info.si_code != CLD_EXITED && info.si_status == SIGINT)
+                    pool[s].interrupted = 1;
+                if (info.si_code != CLD_EXITED || info.si_status != 0)
+                    pool[s].failed = 1;
+                add_job_usage(shell->job_list, pid, &usage);
+                if (remove_job_member(shell->job_list, pid) > 0) continue;
+                remove_job_jid(shell->job_list, first + s);
+                pool[s].busy = 0;
+                finished++;
+            }
+            if (!pool[s].busy ||
+                count_job_members(shell->job_list, first + s, RUNNING) > 0)
+                continue;
+            // every process left in the job is suspended
+            if (printf("[%d] (%d) suspended by signal %d\n", first + s,
+                       get_job_pid(shell->job_list, first + s),
+                       pool[s].stopsig) < 0) {
+                perror("Error printing signal suspension.");
+                cleanup_job_list(shell->job_list);
+                exit(1);
+            }
+            update_job_jid(shell->job_list, first + s, STOPPED);
+            pool[s].busy = 0;
+            pool[s].stopped = 1;
+            finished++;
+        }
+    }
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+    return finished;
+}
+
+// Adds arg to the *n failed arguments in failures, which it takes over.
+// Returns the grown array
+static char **addFailure(shell_t *shell, char **failures, int *n, char *arg) {
+    char **grown = realloc(failures, sizeof(char *) * (size_t)(*n + 1));
+    if (grown == NULL) {
+        perror("Error allocating parallel");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    grown[(*n)++] = arg;
+    return grown;
+}
+
+// builtin command: parallel
+// parallel [-j N] template... [::: args...] runs the template once per
+// argument, at most N (by default, one per CPU) at a time as jobs of their
+// own, starting the next as soon as one finishes. Without :::, the arguments
+// are the lines of the shell's stdin, up to its end, or if stdin is a terminal,
+// up to an empty line. The jobs share one process group, which holds the
+// terminal while the shell waits on them, so ^C and ^Z reach them all. Once a
+// job has been interrupted or suspended, no more are started; suspended jobs
+// are left on the job list. Once all are done, the arguments whose jobs failed
+// are reported together
+static void runParallel(shell_t *shell, char **argv, int argc) {
+    int nslots = (int)sysconf(_SC_NPROCESSORS_ONLN), t = 1, sep = t;
+    if (strcmp(argv[1], "-j") == 0) {
+        nslots = (int)strtol(argv[2], NULL, 10);
+        t = 3;
+    }
+    if (nslots < 1) nslots = 1;
+    while (sep < argc && strcmp(argv[sep], ":::") != 0) sep++;
+    // without ::: the arguments are read from the shell's stdin, or if the
+    // shell is running a script, from its own stdin
+    line_reader_t *input = NULL;
+    if (sep == argc && (input = shell->input) == NULL &&
+        (input = init_line_reader(STDIN_FILENO)) == NULL) {
+        perror("Error reading arguments");
+        return;
+    }
+    // the words of the command can be in the same buffer the arguments are
+    // read into, which moves what it holds, so they are copied out of it first
+    if (input != NULL) {
+        char **words = arena_alloc(shell->arena, sizeof(char *) * (size_t)sep);
+        for (int i = 0; words != NULL && i < sep; i++) {
+            size_t size = strlen(argv[i]) + 1;
+            if ((words[i] = arena_alloc(shell->arena, size)) == NULL)
+                words = NULL;
+            else
+                memcpy(words[i], argv[i], size);
+        }
+        if (words == NULL) {
+            perror("Error allocating parallel");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        argv = words;
+    }
+    // a terminal has no end of its own to stop at, and reading one to its end
+    // would leave the shell nothing to read after
+    int tty = input != NULL && isatty(STDIN_FILENO);
+    pool_slot_t *pool = calloc((size_t)nslots, sizeof(pool_slot_t));
+    arena_t *arena = init_arena(4096);
+    char **failures = NULL;  // the arguments whose jobs failed
+    int nfailures = 0, njobs = 0, running = 0;
+    int halted = 0;   // set once a job has been interrupted or suspended
+    int done = 0;     // set once there are no more arguments
+    int last = -1;    // the highest slot left holding a suspended job
+    pid_t group = 0;  // the pool's process group, 0 until a job is launched
+    if (pool == NULL || arena == NULL) {
+        perror("Error allocating parallel");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    // a pidfd does not tell a process being suspended, so SIGCHLD is taken
+    // through a signalfd while the pool runs; childReaper's sweep before the
+    // next prompt catches any other child it was for
+    sigset_t chld, mask;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    int sigfd = -1;
+    if (sigprocmask(SIG_BLOCK, &chld, &mask) < 0 ||
+        (sigfd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        perror("Error setting up parallel");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    for (int a = sep + 1;; a++) {
+        size_t len;
+        char *arg = NULL;
+        // a full pool is waited on before the next argument is read, so that
+        // it rather than the shell holds the terminal meanwhile
+        while (running > 0 && (running == nslots || halted || done)) {
+            running -=
+                waitParallel(shell, pool, nslots, shell->jid, group, sigfd);
+            for (int s = 0; s < nslots; s++) {
+                if (pool[s].busy || pool[s].arg == NULL) continue;
+                if (pool[s].stopped || pool[s].interrupted) halted = 1;
+                if (pool[s].stopped && s > last) last = s;
+                if (pool[s].failed)
+                    failures =
+                        addFailure(shell, failures, &nfailures, pool[s].arg);
+                else
+                    free(pool[s].arg);
+                pool[s].arg = NULL;
+            }
+        }
+        // the group is gone once none of its processes is left
+        if (running == 0 && last < 0) group = 0;
+        if (done) break;
+        // once halted, arguments from a file or pipe are still read to the
+        // end, so that the shell does not go on to run them as commands
+        if (input == NULL ? !halted && a < argc : !halted || !tty)
+            arg = input == NULL ? argv[a] : read_line(input, &len);
+        if (arg != NULL && *arg == '\0') {
+            if (!tty) continue;  // blank lines
+            arg = NULL;
+        }
+        if (arg == NULL) done = 1;
+        if (arg == NULL || halted) continue;
+        int s = 0;
+        while (pool[s].busy || pool[s].arg != NULL) s++;
+        njobs++;
+        reset_arena(arena);  // the last job has already exec'd
+        if ((pool[s].arg = strdup(arg)) == NULL) {
+            perror("Error allocating parallel");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        pool[s].failed = 0;
+        pool[s].interrupted = 0;
+        if (launchParallel(shell, argv + t, sep - t, arg, shell->jid + s, group,
+                           arena) == 0) {
+            if (group == 0)
+                group = get_job_pgid(shell->job_list, shell->jid + s);
+            pool[s].busy = 1;
+            running++;
+        } else {  // nothing ran, which is a failure of its own
+            failures = addFailure(shell, failures, &nfailures, pool[s].arg);
+            pool[s].arg = NULL;
+        }
+    }
+    if (nfailures > 0 && fprintf(stderr, "%s: %d of %d jobs failed:", argv[0],
+                                 nfailures, njobs) < 0) {
+        perror("Error printing parallel failures");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    for (int i = 0; i < nfailures; i++) {
+        if (fprintf(stderr, " %s%s", failures[i],
+                    i == nfailures - 1 ? "\n" : "") < 0) {
+            perror("Error printing parallel failures");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+        free(failures[i]);
+    }
+    free(failures);
+    free(pool);
+    cleanup_arena(arena);
+    close(sigfd);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    // the suspended jobs keep the JIDs they were given
+    shell->jid += last + 1;
+    if (input != NULL && input != shell->input) cleanup_line_reader(input);
+}
+
+// builtin command: wait
+static void runWait(shell_t *shell, char **argv, int argc) {
+    int any = argc > 1 && strcmp(argv[1], "-n") == 0;
+    int n = argc - 1 - any;
+    int *jids = arena_alloc(shell->arena, sizeof(int) * (size_t)(n + 1));
+    if (jids == NULL) {
+        perror("Error allocating wait");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        jids[i] = (int)strtol(argv[1 + any + i] + 1, NULL, 10);
+    }
+    shell->status = waitJobs(shell->job_list, stdout, jids, n, any);
+}
+
+// builtin command: history
+static void runHistory(shell_t *shell, char **argv, int argc) {
+    if (shell->history == NULL) return;
+    if ((argc == 3
+             ? search_history(shell->history, argv[2])
+             : print_history(shell->history,
+                             argc == 2 ? strtoul(argv[1], NULL, 10) : 0)) < 0) {
+        perror("Error reading history");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+}
+
+// builtin command: export
+static void runExport(shell_t *shell, char **argv, int argc) {
+    int r = 0;
+    if (argc == 1) r = print_exported(shell->vars);
+    for (int i = 1; i < argc && r == 0; i++) {
+        char *eq = strchr(argv[i], '=');
+        if (eq == NULL) {
+            r = export_var(shell->vars, argv[i]);
+            continue;
+        }
+        *eq = '\0';
+        r = set_var(shell->vars, argv[i], eq + 1, 1);
+        *eq = '=';
+    }
+    if (r < 0) {
+        perror("Error exporting variables");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+}
+
+// builtin command: unset
+static void runUnset(shell_t *shell, char **argv, int argc) {
+    for (int i = 1; i < argc; i++) unset_var(shell->vars, argv[i]);
+}
+
+// Takes the variable assignments (NAME=value words) at the start of the
+// command in tokens[start, end), expanding each in turn. With nothing after
+// them they set shell variables, one after another, so that each sees the ones
+// before it; otherwise they are only for the command, and *envp is set to the
+// environment to launch it with, the shell's with them added. Returns how many
+// tokens the assignments take
+int assignPrefix(token_t *tokens, int start, int end, shell_t *shell,
+                 char ***envp) {
+    int n = 0;
+    while (start + n < end && isAssignment(&tokens[start + n])) n++;
+    char **assigns =
+        n ? arena_alloc(shell->arena, sizeof(char *) * (size_t)n) : NULL;
+    for (int i = 0; i < n && assigns != NULL; i++) {
+        if ((assigns[i] = expandWord(tokens[start + i].start, shell->vars,
+                                     shell->status, shell->arena)) == NULL)
+            assigns = NULL;
+        if (assigns == NULL || start + n < end) continue;
+        char *eq = strchr(assigns[i], '=');
+        *eq = '\0';
+        int r = set_var(shell->vars, assigns[i], eq + 1, 0);
+        *eq = '=';
+        if (r < 0) {
+            perror("Error setting variable");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+    if (start + n == end && (n == 0 || assigns != NULL)) return n;
+    if (n == 0)
+        *envp = get_envp(shell->vars);
+    else
+        *envp = assigns ? get_envp_with(shell->vars, assigns, n, shell->arena)
+                        : NULL;
+    if (*envp == NULL) {
+        perror("Error building environment");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+    return n;
+}
+
+// builtin command: bg
+static void runBg(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    int cur_jid = (int)strtol(argv[1] + 1, NULL, 10);
+    int cur_pid = get_job_pid(shell->job_list, cur_jid);
+    if (signal_job(shell->job_list, cur_jid, SIGCONT) == 0) {
+        update_job_pid(shell->job_list, cur_pid, RUNNING);
+    } else {
+        if (fprintf(stderr, "%s: kill error\n", argv[0]) < 0) {
+            perror("Error printing kill error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+}
+
+// builtin command: fg
+static void runFg(shell_t *shell, char **argv, int argc) {
+    (void)argc;
+    int cur_jid = (int)strtol(argv[1] + 1, NULL, 10);
+    pid_t pgid = get_job_pgid(shell->job_list, cur_jid);
+    if (signal_job(shell->job_list, cur_jid, SIGCONT) == -1) {
+        if (fprintf(stderr, "%s: kill error\n", argv[0]) < 0) {
+            perror("Error printing kill error");
+            cleanup_job_list(shell->job_list);
+            exit(1);
+        }
+    }
+    tcsetpgrp(STDIN_FILENO, pgid);
+    waitForeground(shell->job_list, cur_jid, &shell->status);
+}
+
+// Every builtin. To add one, add it here; the lookup table is built from this
+// when the shell starts
+static const builtin_t builtins[] = {
+    {"exit", runExit, 1, 1, NULL},
+    {"cd", runCd, 2, 2, NULL},
+    {"pushd", runPushd, 1, 2, NULL},
+    {"popd", runPopd, 1, 1, NULL},
+    {"dirs", runDirs, 1, 1, NULL},
+    {"ln", runLn, 3, 3, linkRule},
+    {"rm", runRm, 2, 2, NULL},
+    {"jobs", runJobs, 1, 2, jobsRule},
+    {"hash", runHash, 1, 2, hashRule},
+    {"bg", runBg, 2, 2, jobIdRule},
+    {"fg", runFg, 2, 2, jobIdRule},
+    {"ulimit", runUlimit, 1, 11, ulimitRule},
+    {"pin", runPin, 3, 5, pinRule},
+    {"parallel", runParallel, 2, INT_MAX, parallelRule},
+    {"wait", runWait, 1, INT_MAX, waitRule},
+    {"history", runHistory, 1, 3, historyRule},
+    {"export", runExport, 1, INT_MAX, exportRule},
+    {"unset", runUnset, 2, INT_MAX, exportRule},
+};
+
+// Runs a builtin under time. Builtins run in the shell itself, so what is
+// reported is the shell's own resource usage while it ran (and the shell's max
+// RSS)
+void timeBuiltin(const builtin_t *builtin, shell_t *shell, char **argv,
+                 int argc) {
+    struct rusage before, usage;
+    struct timespec start, elapsed;
+    getrusage(RUSAGE_SELF, &before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    builtin->run(shell, argv, argc);
+    clock_gettime(CLOCK_MONOTONIC, &elapsed);
+    getrusage(RUSAGE_SELF, &usage);
+    elapsed.tv_sec -= start.tv_sec;
+    elapsed.tv_nsec -= start.tv_nsec;
+    if (elapsed.tv_nsec < 0) {
+        elapsed.tv_sec--;
+        elapsed.tv_nsec += 1000000000L;
+    }
+    timersub(&usage.ru_utime, &before.ru_utime, &usage.ru_utime);
+    timersub(&usage.ru_stime, &before.ru_stime, &usage.ru_stime);
+    usage.ru_minflt -= before.ru_minflt;
+    usage.ru_majflt -= before.ru_majflt;
+    usage.ru_nvcsw -= before.ru_nvcsw;
+    usage.ru_nivcsw -= before.ru_nivcsw;
+    if (fflush(stdout) < 0 || print_usage(&usage, &elapsed) < 0) {
+        perror("Error printing time");
+        cleanup_job_list(shell->job_list);
+        exit(1);
+    }
+}
+
+// slots in the lookup table, a power of two; the more room there is, the
+// sooner a seed is found that gives every builtin a slot of its own
+#define BUILTIN_SLOTS 64
+
+// the lookup table: slot builtinHash(name) holds the only builtin that name
+// can be, or NULL
+static const builtin_t *builtinTable[BUILTIN_SLOTS];
+static uint32_t builtinSeed;
+
+// FNV-1a hash of a command name, starting from seed, as a slot of the table
+static uint32_t builtinHash(const char *name, uint32_t seed) {
+    uint32_t h = seed;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 16777619U;
+    }
+    return h & (BUILTIN_SLOTS - 1);
+}
+
+// Builds the lookup table, trying seeds until one hashes every builtin to a
+// different slot, which makes it a perfect hash. Returns 0, -1 if no seed
+// works
+int initBuiltins(void) {
+    size_t n = sizeof(builtins) / sizeof(builtins[0]);
+    for (uint32_t seed = 2166136261U; seed != 2166136261U + 65536U; seed++) {
+        size_t i;
+        memset(builtinTable, 0, sizeof(builtinTable));
+        for (i = 0; i < n; i++) {
+            uint32_t slot = builtinHash(builtins[i].name, seed);
+            if (builtinTable[slot] != NULL) break;
+            builtinTable[slot] = &builtins[i];
+        }
+        if (i == n) {
+            builtinSeed = seed;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Finds the builtin called name with one hash and one string compare. Returns
+// NULL if there is none, i.e. name is a command to launch
+const builtin_t *findBuiltin(const char *name) {
+    const builtin_t *builtin = builtinTable[builtinHash(name, builtinSeed)];
+    return builtin != NULL && strcmp(builtin->name, name) == 0 ? builtin : NULL;
+}
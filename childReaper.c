@@ -1,30 +1,149 @@
+#include <errno.h>
 #include <stdio.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
+#include <unistd.h>
 #include "jobs.h"
 
-void childReaper(job_list_t *job_list) {
-    pid_t wret;
-    int wstatus;
-    while ((wret = waitpid(-1, &wstatus, WNOHANG | WUNTRACED | WCONTINUED)) >
-           0) {
-        if (WIFEXITED(wstatus)) {
-            printf("[%d] (%d) terminated with exit status %d\n",
-                   get_job_jid(job_list, wret), wret, WEXITSTATUS(wstatus));
-            remove_job_pid(job_list, wret);
+// waitid(), with the resource usage of the child it reports stored in *usage;
+// glibc's waitid() leaves out the system call's last argument
+int waitUsage(idtype_t idtype, id_t id, siginfo_t *info, int options,
+              struct rusage *usage) {
+    return (int)syscall(SYS_waitid, idtype, id, info, options, usage);
+}
+
+// Takes in a state change of a child reaped by waitid(), with its resource
+// usage, updating the job list and printing the job's report to out once all
+// of its members agree: a job with several processes (a pipeline) is only
+// reported once every member has finished, been suspended or been resumed. The
+// resource usage of a timed job that has finished goes to stderr. If the job
+// finished, its JID is stored in *jid and its status (the exit status, or 128
+// plus the signal that killed it) in *status; otherwise *jid is set to 0. A
+// child that is no job's, such as the generator of a <(...) script that the
+// shell inherited when it was exec'd, is just reaped.
+// Returns 1 if the job was reported, 0 if not
+static int reportChild(job_list_t *job_list, FILE *out, const siginfo_t *info,
+                       const struct rusage *usage, int *jid, int *status) {
+    pid_t wret = info->si_pid;
+    int cur_jid = get_job_jid(job_list, wret);
+    *jid = 0;
+    if (cur_jid == -1) return 0;
+    pid_t pid = get_job_pid(job_list, cur_jid);
+    switch (info->si_code) {
+        case CLD_EXITED:
+        case CLD_KILLED:
+        case CLD_DUMPED:
+            add_job_usage(job_list, wret, usage);
+            if (remove_job_member(job_list, wret) > 0) return 0;
+            if (info->si_code == CLD_EXITED) {
+                fprintf(out, "[%d] (%d) terminated with exit status %d\n",
+                        cur_jid, pid, info->si_status);
+            } else {
+                fprintf(out, "[%d] (%d) terminated by signal %d\n", cur_jid,
+                        pid, info->si_status);
+            }
+            fflush(out);  // the job's report comes before its usage
+            report_job_usage(job_list, cur_jid);
+            remove_job_jid(job_list, cur_jid);
+            *jid = cur_jid;
+            *status = info->si_code == CLD_EXITED ? info->si_status
+                                                  : 128 + info->si_status;
+            return 1;
+        case CLD_STOPPED:
+        case CLD_TRAPPED:
+            update_job_member(job_list, wret, STOPPED);
+            if (count_job_members(job_list, cur_jid, RUNNING) > 0) return 0;
+            fprintf(out, "[%d] (%d) suspended by signal %d\n", cur_jid, pid,
+                    info->si_status);
+            update_job_jid(job_list, cur_jid, STOPPED);
+            return 1;
+        case CLD_CONTINUED:
+            update_job_member(job_list, wret, RUNNING);
+            if (count_job_members(job_list, cur_jid, STOPPED) > 0) return 0;
+            fprintf(out, "[%d] (%d) resumed\n", cur_jid, pid);
+            update_job_jid(job_list, cur_jid, RUNNING);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Reaps every child whose state has changed and reports it, in one sweep of
+// waitid() calls that stops as soon as no child is left waiting. A job with
+// several processes (a pipeline) is only reported once all of its members have
+// finished, been suspended or been resumed. Reports are printed to out, and
+// the resource usage of a timed job once it has finished to stderr.
+// Returns the number of jobs reported
+int childReaper(job_list_t *job_list, FILE *out) {
+    siginfo_t info;
+    struct rusage usage;
+    int reported = 0, jid, status;
+    while (1) {
+        info.si_pid = 0;  // left alone by waitid() if no child has changed
+        if (waitUsage(P_ALL, 0, &info,
+                      WEXITED | WSTOPPED | WCONTINUED | WNOHANG, &usage) < 0 ||
+            info.si_pid == 0) {
+            return reported;
         }
-        if (WIFSIGNALED(wstatus)) {
-            printf("[%d] (%d) terminated by signal %d\n",
-                   get_job_jid(job_list, wret), wret, WTERMSIG(wstatus));
-            remove_job_pid(job_list, wret);
+        reported += reportChild(job_list, out, &info, &usage, &jid, &status);
+    }
+}
+
+// Whether any of the n jobs in jids (with n 0, any job on the list) is still
+// to be waited for: it has a member that has neither finished nor been
+// suspended
+static int waitingFor(job_list_t *job_list, const int *jids, int n) {
+    int waiting = 0;
+    if (n == 0) {
+        pid_t pid;
+        // the iterator is run to its end so that it starts over next time
+        while ((pid = get_next_pid(job_list)) != -1) {
+            if (count_job_members(job_list, get_job_jid(job_list, pid),
+                                  RUNNING) > 0)
+                waiting = 1;
         }
-        if (WIFSTOPPED(wstatus)) {
-            printf("[%d] (%d) suspended by signal %d\n",
-                   get_job_jid(job_list, wret), wret, WSTOPSIG(wstatus));
-            update_job_pid(job_list, wret, STOPPED);
+    }
+    for (int i = 0; i < n; i++) {
+        if (count_job_members(job_list, jids[i], RUNNING) > 0) waiting = 1;
+    }
+    return waiting;
+}
+
+// The wait builtin's blocking: reaps and reports every child's state changes
+// as childReaper() does, until the n jobs in jids (with n 0, every job on the
+// list) have all finished or been suspended, or with any set, until one of
+// them has finished. In between, it blocks in waitid() with WNOWAIT, which
+// returns once there is a change to reap without reaping it, so waiting takes
+// no CPU time. Returns the status of the last of the jobs in jids to finish
+// (with any, of the one that finished, or 127 if none was left to), 0 if none
+// did
+int waitJobs(job_list_t *job_list, FILE *out, const int *jids, int n, int any) {
+    siginfo_t info;
+    struct rusage usage;
+    int result = any ? 127 : 0, found = 0, jid, status;
+    while (!found && waitingFor(job_list, jids, n)) {
+        if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WCONTINUED | WNOWAIT) <
+            0) {
+            if (errno == EINTR) continue;
+            break;  // ECHILD: there is nothing left to wait for
         }
-        if (WIFCONTINUED(wstatus)) {
-            printf("[%d] (%d) resumed\n", get_job_jid(job_list, wret), wret);
-            update_job_pid(job_list, wret, RUNNING);
+        // reap everything that is waiting by now, noting what finished
+        while (1) {
+            info.si_pid = 0;
+            if (waitUsage(P_ALL, 0, &info,
+                          WEXITED | WSTOPPED | WCONTINUED | WNOHANG,
+                          &usage) < 0 ||
+                info.si_pid == 0)
+                break;
+            reportChild(job_list, out, &info, &usage, &jid, &status);
+            for (int i = 0; jid != 0 && i < (n == 0 && any ? 1 : n); i++) {
+                if (n == 0 || jids[i] == jid) {
+                    result = status;
+                    found = any;
+                }
+            }
         }
     }
-}
\ No newline at end of file
+    return result;
+}
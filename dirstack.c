@@ -0,0 +1,272 @@
+#include "./dirstack.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// a directory, held open with O_PATH so the shell can change back to it with
+// fchdir() without resolving its path again
+// fd is -1 for no directory
+struct dir_entry {
+    int fd;
+    char *path;
+};
+typedef struct dir_entry dir_entry_t;
+
+// cwd is the current directory and old the previous one (for cd -)
+// stack holds depth pushed directories, the last one on top, and has room for
+// size
+struct dir_stack {
+    dir_entry_t cwd;
+    dir_entry_t old;
+    dir_entry_t *stack;
+    int depth;
+    int size;
+};
+
+/* closes a directory and forgets its path */
+static void close_entry(dir_entry_t *e) {
+    if (e->fd >= 0) close(e->fd);
+    free(e->path);
+    e->fd = -1;
+    e->path = NULL;
+}
+
+/* opens dir relative to at as a directory entry, returns 0 on success, -1 on
+ * failure */
+static int open_entry(dir_entry_t *e, int at, const char *dir) {
+    e->fd = openat(at, dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    e->path = NULL;
+    return e->fd < 0 ? -1 : 0;
+}
+
+/* copies from into to, giving to its own fd */
+static void copy_entry(dir_entry_t *to, const dir_entry_t *from) {
+    to->fd = fcntl(from->fd, F_DUPFD_CLOEXEC, 0);
+    to->path = from->path ? strdup(from->path) : NULL;
+}
+
+/* initializes directory stack, with the current directory on top, returns
+ * pointer, NULL on failure */
+dir_stack_t *init_dir_stack() {
+    dir_stack_t *dir_stack = (dir_stack_t *)malloc(sizeof(dir_stack_t));
+    if (open_entry(&dir_stack->cwd, AT_FDCWD, ".") < 0) {
+        free(dir_stack);
+        return NULL;
+    }
+    dir_stack->cwd.path = getcwd(NULL, 0);
+    dir_stack->old.fd = -1;
+    dir_stack->old.path = NULL;
+    dir_stack->stack = NULL;
+    dir_stack->depth = 0;
+    dir_stack->size = 0;
+    return dir_stack;
+}
+
+/*
+ * cleans up directory stack
+ * Note: this function will free the dir_stack pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_dir_stack(dir_stack_t *dir_stack) {
+    if (dir_stack == NULL) {
+        return;
+    }
+
+    close_entry(&dir_stack->cwd);
+    close_entry(&dir_stack->old);
+    for (int i = 0; i < dir_stack->depth; i++) {
+        close_entry(&dir_stack->stack[i]);
+    }
+    free(dir_stack->stack);
+    free(dir_stack);
+}
+
+/*
+ * changes to the directory e, which becomes the current one, and makes the
+ * current one the previous one, then updates PWD and OLDPWD
+ * returns 0 on success, -1 on failure, in which case e is left alone
+ */
+static int enter(dir_stack_t *dir_stack, dir_entry_t e) {
+    if (fchdir(e.fd) < 0) {
+        return -1;
+    }
+    if (e.path == NULL) e.path = getcwd(NULL, 0);
+    if (dir_stack->old.fd != e.fd) close_entry(&dir_stack->old);
+    dir_stack->old = dir_stack->cwd;
+    dir_stack->cwd = e;
+    if (dir_stack->old.path != NULL) setenv("OLDPWD", dir_stack->old.path, 1);
+    if (dir_stack->cwd.path != NULL) setenv("PWD", dir_stack->cwd.path, 1);
+    return 0;
+}
+
+/*
+ * opens dir as cd would find it: a relative dir not starting with "." or ".."
+ * is looked for in each directory on CDPATH before the current one
+ * sets *found to 1 if it was found through a non-empty CDPATH entry
+ * returns 0 on success, -1 on failure
+ */
+static int find_dir(dir_stack_t *dir_stack, const char *dir, dir_entry_t *e,
+                    int *found) {
+    const char *cdpath = getenv("CDPATH");
+    *found = 0;
+    if (cdpath != NULL && dir[0] != '/' && strcmp(dir, ".") != 0 &&
+        strcmp(dir, "..") != 0 && strncmp(dir, "./", 2) != 0 &&
+        strncmp(dir, "../", 3) != 0) {
+        size_t dirlen = strlen(dir);
+        const char *start = cdpath;
+        while (1) {
+            const char *end = strchr(start, ':');
+            size_t len = end == NULL ? strlen(start) : (size_t)(end - start);
+            char *path = (char *)malloc(len + dirlen + 2);
+            memcpy(path, start, len);
+            path[len] = '/';
+            memcpy(path + len + 1, dir, dirlen + 1);
+            // an empty entry is the current directory
+            if (open_entry(e, dir_stack->cwd.fd, len ? path : dir) == 0) {
+                *found = len > 0;
+                free(path);
+                return 0;
+            }
+            free(path);
+            if (end == NULL) break;
+            start = end + 1;
+        }
+    }
+    return open_entry(e, dir_stack->cwd.fd, dir);
+}
+
+/*
+ * cd command, changes to dir, or back to the previous directory if dir is "-"
+ * a relative dir not starting with "." or ".." is looked for in the
+ * directories on CDPATH first
+ * prints the new directory if it is not the one that was asked for, i.e. for
+ * "-" and when it was found on CDPATH
+ * returns 0 on success, 1 if there is no previous directory, -1 on failure
+ * (with errno set)
+ */
+int change_dir(dir_stack_t *dir_stack, const char *dir) {
+    if (dir_stack == NULL) {
+        return -1;
+    }
+
+    dir_entry_t e;
+    int found;
+    if (strcmp(dir, "-") == 0) {
+        if (dir_stack->old.fd < 0) {
+            return 1;
+        }
+        e = dir_stack->old;
+        found = 1;
+    } else if (find_dir(dir_stack, dir, &e, &found) < 0) {
+        return -1;
+    }
+    if (enter(dir_stack, e) < 0) {
+        int err = errno;
+        if (e.fd != dir_stack->old.fd) close_entry(&e);
+        errno = err;
+        return -1;
+    }
+    if (found && dir_stack->cwd.path != NULL &&
+        printf("%s\n", dir_stack->cwd.path) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * pushd command, pushes the current directory and changes to dir, or if dir is
+ * NULL swaps the current directory with the one on top of the stack
+ * returns 0 on success, 1 if there is nothing on the stack to swap with, -1 on
+ * failure (with errno set)
+ */
+int push_dir(dir_stack_t *dir_stack, const char *dir) {
+    if (dir_stack == NULL) {
+        return -1;
+    }
+
+    if (dir == NULL) {
+        if (dir_stack->depth == 0) {
+            return 1;
+        }
+        dir_entry_t *top = &dir_stack->stack[dir_stack->depth - 1];
+        dir_entry_t e = *top;
+        if (enter(dir_stack, e) < 0) {
+            return -1;
+        }
+        // the directory we left takes the place of the one we went to
+        copy_entry(top, &dir_stack->old);
+        return 0;
+    }
+
+    dir_entry_t e;
+    int found;
+    if (find_dir(dir_stack, dir, &e, &found) < 0) {
+        return -1;
+    }
+    if (dir_stack->depth == dir_stack->size) {
+        int size = dir_stack->size ? dir_stack->size * 2 : 8;
+        dir_entry_t *stack = (dir_entry_t *)realloc(
+            dir_stack->stack, sizeof(dir_entry_t) * (size_t)size);
+        if (stack == NULL) {
+            close_entry(&e);
+            return -1;
+        }
+        dir_stack->stack = stack;
+        dir_stack->size = size;
+    }
+    if (enter(dir_stack, e) < 0) {
+        int err = errno;
+        close_entry(&e);
+        errno = err;
+        return -1;
+    }
+    copy_entry(&dir_stack->stack[dir_stack->depth++], &dir_stack->old);
+    return 0;
+}
+
+/*
+ * popd command, changes to the directory on top of the stack and pops it
+ * returns 0 on success, 1 if the stack is empty, -1 on failure (with errno
+ * set)
+ */
+int pop_dir(dir_stack_t *dir_stack) {
+    if (dir_stack == NULL) {
+        return -1;
+    }
+
+    if (dir_stack->depth == 0) {
+        return 1;
+    }
+    if (enter(dir_stack, dir_stack->stack[dir_stack->depth - 1]) < 0) {
+        return -1;
+    }
+    dir_stack->depth--;
+    return 0;
+}
+
+/* dirs command, prints the current directory followed by the stack */
+void print_dir_stack(dir_stack_t *dir_stack) {
+    if (dir_stack == NULL) {
+        return;
+    }
+
+    const char *cwd = dir_stack->cwd.path ? dir_stack->cwd.path : ".";
+    if (printf("%s", cwd) < 0) {
+        fprintf(stderr, "error printing directory stack\n");
+        return;
+    }
+    for (int i = dir_stack->depth - 1; i >= 0; i--) {
+        const char *path =
+            dir_stack->stack[i].path ? dir_stack->stack[i].path : "?";
+        if (printf(" %s", path) < 0) {
+            fprintf(stderr, "error printing directory stack\n");
+            return;
+        }
+    }
+    if (printf("\n") < 0) {
+        fprintf(stderr, "error printing directory stack\n");
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DIRSTACK_H_
+#define DIRSTACK_H_
+
+typedef struct dir_stack dir_stack_t;
+
+/* initializes directory stack, with the current directory on top, returns
+ * pointer, NULL on failure */
+dir_stack_t *init_dir_stack();
+/*
+ * cleans up directory stack
+ * Note: this function will free the dir_stack pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_dir_stack(dir_stack_t *dir_stack);
+
+/*
+ * cd command, changes to dir, or back to the previous directory if dir is "-"
+ * a relative dir not starting with "." or ".." is looked for in the
+ * directories on CDPATH first
+ * prints the new directory if it is not the one that was asked for, i.e. for
+ * "-" and when it was found on CDPATH
+ * returns 0 on success, 1 if there is no previous directory, -1 on failure
+ * (with errno set)
+ */
+int change_dir(dir_stack_t *dir_stack, const char *dir);
+
+/*
+ * pushd command, pushes the current directory and changes to dir, or if dir is
+ * NULL swaps the current directory with the one on top of the stack
+ * returns 0 on success, 1 if there is nothing on the stack to swap with, -1 on
+ * failure (with errno set)
+ */
+int push_dir(dir_stack_t *dir_stack, const char *dir);
+
+/*
+ * popd command, changes to the directory on top of the stack and pops it
+ * returns 0 on success, 1 if the stack is empty, -1 on failure (with errno
+ * set)
+ */
+int pop_dir(dir_stack_t *dir_stack);
+
+/* dirs command, prints the current directory followed by the stack */
+void print_dir_stack(dir_stack_t *dir_stack);
+
+#endif  // DIRSTACK_H_
@@ -0,0 +1,148 @@
+#include "./events.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// how often the timer makes the shell check on its children even without a
+// SIGCHLD; SIGCHLDs are merged while one is pending, and the sweep that follows
+// one catches every child anyway, so this is only a backstop
+#define EVENT_SWEEP_SECONDS 1
+
+// epoll watches fd, the signalfd and the timerfd
+// ready holds the events from the last epoll_wait() that have not been handed
+// out yet, as bits: 1 for input, 2 for a child
+// regular files cannot be watched with epoll, but are always readable, so fd
+// is then left out and file is set
+struct event_loop {
+    int fd;
+    int file;
+    int epoll;
+    int signal;
+    int timer;
+    int ready;
+    sigset_t mask;
+};
+
+#define READY_INPUT 1
+#define READY_CHILD 2
+
+/* adds fd to the epoll set, tagged with the ready bit it stands for */
+static int watch(int epoll, int fd, int ready) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)ready;
+    return epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*
+ * initializes an event loop watching fd for input, returns pointer, NULL on
+ * failure
+ * SIGCHLD is blocked and delivered through a signalfd instead, and a timerfd
+ * wakes the loop every EVENT_SWEEP_SECONDS
+ */
+event_loop_t *init_event_loop(int fd) {
+    event_loop_t *event_loop = (event_loop_t *)malloc(sizeof(event_loop_t));
+    event_loop->fd = fd;
+    event_loop->file = 0;
+    event_loop->ready = 0;
+    event_loop->signal = -1;
+    event_loop->timer = -1;
+    sigemptyset(&event_loop->mask);
+    sigaddset(&event_loop->mask, SIGCHLD);
+
+    if ((event_loop->epoll = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+        sigprocmask(SIG_BLOCK, &event_loop->mask, NULL) < 0 ||
+        (event_loop->signal =
+             signalfd(-1, &event_loop->mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0 ||
+        (event_loop->timer =
+             timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        cleanup_event_loop(event_loop);
+        return NULL;
+    }
+
+    struct itimerspec sweep = {{EVENT_SWEEP_SECONDS, 0},
+                               {EVENT_SWEEP_SECONDS, 0}};
+    if (watch(event_loop->epoll, fd, READY_INPUT) < 0) {
+        if (errno != EPERM) {
+            cleanup_event_loop(event_loop);
+            return NULL;
+        }
+        event_loop->file = 1;
+    }
+    if (timerfd_settime(event_loop->timer, 0, &sweep, NULL) < 0 ||
+        watch(event_loop->epoll, event_loop->signal, READY_CHILD) < 0 ||
+        watch(event_loop->epoll, event_loop->timer, READY_CHILD) < 0) {
+        cleanup_event_loop(event_loop);
+        return NULL;
+    }
+    return event_loop;
+}
+
+/*
+ * cleans up event loop and unblocks SIGCHLD
+ * Note: this function will free the event_loop pointer and does not close fd
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_event_loop(event_loop_t *event_loop) {
+    if (event_loop == NULL) {
+        return;
+    }
+
+    if (event_loop->epoll >= 0) close(event_loop->epoll);
+    if (event_loop->signal >= 0) close(event_loop->signal);
+    if (event_loop->timer >= 0) close(event_loop->timer);
+    sigprocmask(SIG_UNBLOCK, &event_loop->mask, NULL);
+    free(event_loop);
+}
+
+/* empties the signalfd and the timerfd so they stop being readable */
+static void drain(event_loop_t *event_loop) {
+    struct signalfd_siginfo info;
+    uint64_t expirations;
+    while (read(event_loop->signal, &info, sizeof(info)) > 0) {
+    }
+    if (read(event_loop->timer, &expirations, sizeof(expirations)) < 0) {
+        return;  // the timer had not expired
+    }
+}
+
+/*
+ * blocks until something happens
+ * returns EVENT_CHILD if a child may have changed state (SIGCHLD arrived or
+ * the timer expired), EVENT_INPUT if fd is readable, EVENT_ERROR on failure
+ * EVENT_CHILD is returned first when both are ready
+ */
+event_t wait_event(event_loop_t *event_loop) {
+    if (event_loop == NULL) {
+        return EVENT_ERROR;
+    }
+
+    while (event_loop->ready == 0) {
+        struct epoll_event evs[3];
+        // a file is always readable, so only check for children without
+        // waiting
+        int n =
+            epoll_wait(event_loop->epoll, evs, 3, event_loop->file ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return EVENT_ERROR;
+        }
+        if (event_loop->file) event_loop->ready |= READY_INPUT;
+        for (int i = 0; i < n; i++) {
+            event_loop->ready |= (int)evs[i].data.u32;
+        }
+    }
+
+    if (event_loop->ready & READY_CHILD) {
+        event_loop->ready &= ~READY_CHILD;
+        drain(event_loop);
+        return EVENT_CHILD;
+    }
+    event_loop->ready &= ~READY_INPUT;
+    return EVENT_INPUT;
+}
@@ -0,0 +1,31 @@
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+typedef struct event_loop event_loop_t;
+
+// what wait_event() woke up for
+typedef enum { EVENT_INPUT, EVENT_CHILD, EVENT_ERROR } event_t;
+
+/*
+ * initializes an event loop watching fd for input, returns pointer, NULL on
+ * failure
+ * SIGCHLD is blocked and delivered through a signalfd instead, and a timerfd
+ * wakes the loop every EVENT_SWEEP_SECONDS
+ */
+event_loop_t *init_event_loop(int fd);
+/*
+ * cleans up event loop and unblocks SIGCHLD
+ * Note: this function will free the event_loop pointer and does not close fd
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_event_loop(event_loop_t *event_loop);
+
+/*
+ * blocks until something happens
+ * returns EVENT_CHILD if a child may have changed state (SIGCHLD arrived or
+ * the timer expired), EVENT_INPUT if fd is readable, EVENT_ERROR on failure
+ * EVENT_CHILD is returned first when both are ready
+ */
+event_t wait_event(event_loop_t *event_loop);
+
+#endif  // EVENTS_H_
@@ -0,0 +1,421 @@
+#include "./history.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// buckets in the trigram table to start with, a power of two
+#define HISTORY_BUCKETS 4096
+
+// the lines of the history that have a trigram, or that start with one to
+// three bytes, by number, in increasing order
+typedef struct {
+    uint32_t trigram;  // its key (see trigram_at(), start_at()), 0 if free
+    uint32_t *lines;
+    uint32_t nlines;
+    uint32_t size;
+} posting_t;
+
+// fd is the history file, opened for appending, and map its mapping, of
+// mapped bytes
+// lines holds the offset of the start of each of the first nlines lines
+// (lines_size is its room), which end at offset scanned, and indexed is how
+// many of those have their trigrams, and started how many have their first
+// bytes, in the
+// trigram table, which has nbuckets buckets of which used are in use
+struct history {
+    int fd;
+    char *map;
+    size_t mapped;
+    size_t *lines;
+    size_t nlines;
+    size_t lines_size;
+    size_t scanned;
+    posting_t *buckets;
+    size_t nbuckets;
+    size_t used;
+    size_t indexed;
+    size_t started;
+};
+
+/* forgets every line indexed so far, for when the file has been truncated */
+static void forget_lines(history_t *history) {
+    for (size_t i = 0; i < history->nbuckets; i++) {
+        free(history->buckets[i].lines);
+    }
+    memset(history->buckets, 0, sizeof(posting_t) * history->nbuckets);
+    history->used = 0;
+    history->nlines = 0;
+    history->scanned = 0;
+    history->indexed = 0;
+    history->started = 0;
+}
+
+/*
+ * maps the file again if it has changed size since it was last mapped, e.g.
+ * because this or another shell added lines to it
+ * returns 0 on success, -1 on failure
+ */
+static int refresh(history_t *history) {
+    struct stat st;
+    if (fstat(history->fd, &st) < 0) {
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == history->mapped) {
+        return 0;
+    }
+    if (history->map != NULL) {
+        munmap(history->map, history->mapped);
+        history->map = NULL;
+    }
+    if (size < history->mapped) {
+        forget_lines(history);
+    }
+    history->mapped = size;
+    if (size == 0) {
+        return 0;
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, history->fd, 0);
+    if (map == MAP_FAILED) {
+        history->mapped = 0;
+        return -1;
+    }
+    history->map = (char *)map;
+    return 0;
+}
+
+/*
+ * initializes the history kept in the file at path, which is created if it
+ * does not exist, returns pointer, NULL on failure
+ * the file is mapped with mmap() here, not read, so this takes the same time
+ * however long the history is; it is mapped again whenever it has grown, and
+ * the indexes are built the first time they are needed
+ */
+history_t *init_history(const char *path) {
+    history_t *history = (history_t *)calloc(1, sizeof(history_t));
+    if (history == NULL) {
+        return NULL;
+    }
+    history->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (history->fd < 0) {
+        free(history);
+        return NULL;
+    }
+    if (refresh(history) < 0) {
+        close(history->fd);
+        free(history);
+        return NULL;
+    }
+    return history;
+}
+
+/*
+ * cleans up history
+ * Note: this function will free the history pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_history(history_t *history) {
+    if (history->map != NULL) {
+        munmap(history->map, history->mapped);
+    }
+    for (size_t i = 0; i < history->nbuckets; i++) {
+        free(history->buckets[i].lines);
+    }
+    free(history->buckets);
+    free(history->lines);
+    close(history->fd);
+    free(history);
+}
+
+/* where the complete lines of the mapping end: after its last '\n' */
+static size_t complete_end(const history_t *history) {
+    size_t end = history->mapped;
+    while (end > 0 && history->map[end - 1] != '\n') {
+        end--;
+    }
+    return end;
+}
+
+/*
+ * finds the start of every complete line the line index does not have yet,
+ * returns 0 on success, -1 on failure
+ */
+static int index_lines(history_t *history) {
+    if (refresh(history) < 0) {
+        return -1;
+    }
+    size_t end = complete_end(history), p = history->scanned;
+    while (p < end) {
+        if (history->nlines == history->lines_size) {
+            size_t size = history->lines_size ? history->lines_size * 2 : 1024;
+            size_t *lines =
+                (size_t *)realloc(history->lines, sizeof(size_t) * size);
+            if (lines == NULL) {
+                return -1;
+            }
+            history->lines = lines;
+            history->lines_size = size;
+        }
+        history->lines[history->nlines++] = p;
+        const char *nl = memchr(history->map + p, '\n', end - p);
+        p = (size_t)(nl - history->map) + 1;
+    }
+    history->scanned = p;
+    return 0;
+}
+
+/* length of line i, without its '\n' */
+static size_t line_length(const history_t *history, size_t i) {
+    const char *start = history->map + history->lines[i];
+    return (size_t)(
+        (const char *)memchr(start, '\n', history->mapped - history->lines[i]) -
+        start);
+}
+
+/* the bucket holding trigram (plus 1), or the free bucket where it would go */
+static posting_t *find_bucket(posting_t *buckets, size_t nbuckets,
+                              uint32_t trigram) {
+    size_t i = (size_t)(trigram * 2654435769u) & (nbuckets - 1);
+    while (buckets[i].trigram != 0 && buckets[i].trigram != trigram) {
+        i = (i + 1) & (nbuckets - 1);
+    }
+    return &buckets[i];
+}
+
+/* the key of the trigram at s */
+static uint32_t trigram_at(const char *s) {
+    return ((uint32_t)(unsigned char)s[0] << 16 |
+            (uint32_t)(unsigned char)s[1] << 8 |
+            (uint32_t)(unsigned char)s[2]) +
+           1;
+}
+
+/*
+ * the key of a line starting with the n (1 to 3) bytes at s, which has n in
+ * its top byte so that it is never a trigram's
+ */
+static uint32_t start_at(const char *s, size_t n) {
+    uint32_t key = (uint32_t)n << 24;
+    for (size_t i = 0; i < n; i++) {
+        key |= (uint32_t)(unsigned char)s[i] << (16 - 8 * i);
+    }
+    return key + 1;
+}
+
+/*
+ * adds line number i to the lines with trigram, growing the table when it is
+ * half full, returns 0 on success, -1 on failure
+ */
+static int add_posting(history_t *history, uint32_t trigram, uint32_t i) {
+    if ((history->used + 1) * 2 > history->nbuckets) {
+        size_t nbuckets =
+            history->nbuckets ? history->nbuckets * 2 : HISTORY_BUCKETS;
+        posting_t *buckets = (posting_t *)calloc(nbuckets, sizeof(posting_t));
+        if (buckets == NULL) {
+            return -1;
+        }
+        for (size_t b = 0; b < history->nbuckets; b++) {
+            if (history->buckets[b].trigram != 0) {
+                *find_bucket(buckets, nbuckets, history->buckets[b].trigram) =
+                    history->buckets[b];
+            }
+        }
+        free(history->buckets);
+        history->buckets = buckets;
+        history->nbuckets = nbuckets;
+    }
+    posting_t *posting =
+        find_bucket(history->buckets, history->nbuckets, trigram);
+    if (posting->trigram == 0) {
+        posting->trigram = trigram;
+        history->used++;
+    } else if (posting->lines[posting->nlines - 1] == i) {
+        return 0;  // the line has it more than once
+    }
+    if (posting->nlines == posting->size) {
+        uint32_t size = posting->size ? posting->size * 2 : 4;
+        uint32_t *lines =
+            (uint32_t *)realloc(posting->lines, sizeof(uint32_t) * size);
+        if (lines == NULL) {
+            return -1;
+        }
+        posting->lines = lines;
+        posting->size = size;
+    }
+    posting->lines[posting->nlines++] = i;
+    return 0;
+}
+
+/*
+ * brings both indexes up to date with the file, adding only the lines added
+ * since they last were, returns 0 on success, -1 on failure
+ */
+static int index_trigrams(history_t *history) {
+    if (index_lines(history) < 0) {
+        return -1;
+    }
+    for (; history->indexed < history->nlines; history->indexed++) {
+        const char *line = history->map + history->lines[history->indexed];
+        size_t len = line_length(history, history->indexed);
+        for (size_t j = 0; j + 3 <= len; j++) {
+            if (add_posting(history, trigram_at(line + j),
+                            (uint32_t)history->indexed) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * brings the index of how lines start up to date with the file: each line is
+ * added under its first byte, its first two and its first three, returns 0 on
+ * success, -1 on failure
+ */
+static int index_starts(history_t *history) {
+    if (index_lines(history) < 0) {
+        return -1;
+    }
+    for (; history->started < history->nlines; history->started++) {
+        const char *line = history->map + history->lines[history->started];
+        size_t len = line_length(history, history->started);
+        for (size_t n = 1; n <= 3 && n <= len; n++) {
+            if (add_posting(history, start_at(line, n),
+                            (uint32_t)history->started) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * appends a line (len bytes, without its '\n') to the history file, in a
+ * single write() to a file opened with O_APPEND, so lines from shells sharing
+ * the file are never interleaved
+ * returns 0 on success, -1 on failure
+ */
+int add_history(history_t *history, const char *line, size_t len) {
+    char *buf = (char *)malloc(len + 1);
+    if (buf == NULL) {
+        return -1;
+    }
+    memcpy(buf, line, len);
+    buf[len] = '\n';
+    ssize_t n = write(history->fd, buf, len + 1);
+    free(buf);
+    return n == (ssize_t)(len + 1) ? 0 : -1;
+}
+
+/*
+ * finds the most recent line starting with the len bytes of prefix, taking in
+ * lines added by other shells
+ * lines are found through an index of how each line starts (its first one,
+ * two and three bytes): only the lines starting with the first three bytes of
+ * prefix (or all of it, if shorter) are looked at, most recent first
+ * returns the line, which is not '\0' terminated and is only valid until the
+ * history is next used, and stores its length in *line_len; NULL if there is
+ * none
+ */
+const char *find_history(history_t *history, const char *prefix, size_t len,
+                         size_t *line_len) {
+    if (index_starts(history) < 0 || history->nlines == 0) {
+        return NULL;
+    }
+    if (len == 0) {  // every line starts with it, so the last one is it
+        *line_len = line_length(history, history->nlines - 1);
+        return history->map + history->lines[history->nlines - 1];
+    }
+    if (history->nbuckets == 0) {
+        return NULL;  // every line is empty
+    }
+    posting_t *posting = find_bucket(history->buckets, history->nbuckets,
+                                     start_at(prefix, len < 3 ? len : 3));
+    for (uint32_t k = posting->nlines; k > 0; k--) {
+        size_t i = posting->lines[k - 1];
+        size_t found_len = line_length(history, i);
+        if (found_len >= len &&
+            memcmp(history->map + history->lines[i], prefix, len) == 0) {
+            *line_len = found_len;
+            return history->map + history->lines[i];
+        }
+    }
+    return NULL;
+}
+
+/* prints line i with its number (counting from 1), returns 0, -1 on failure */
+static int print_line(const history_t *history, size_t i) {
+    return printf("%6zu  %.*s\n", i + 1, (int)line_length(history, i),
+                  history->map + history->lines[i]) < 0
+               ? -1
+               : 0;
+}
+
+/*
+ * history command, prints the last n lines (every line if n is 0), numbered
+ * returns 0 on success, -1 on failure
+ */
+int print_history(history_t *history, size_t n) {
+    if (index_lines(history) < 0) {
+        return -1;
+    }
+    size_t first = n == 0 || n > history->nlines ? 0 : history->nlines - n;
+    for (size_t i = first; i < history->nlines; i++) {
+        if (print_line(history, i) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * history -s command, prints every line containing text, numbered, in the
+ * order they were added
+ * lines are found through an index of the trigrams (three byte substrings)
+ * each line has: only the lines with the rarest trigram of text are looked at
+ * returns 0 on success, -1 on failure
+ */
+int search_history(history_t *history, const char *text) {
+    size_t len = strlen(text);
+    if (index_trigrams(history) < 0) {
+        return -1;
+    }
+    if (len < 3) {  // too short to have a trigram, so every line is looked at
+        for (size_t i = 0; i < history->nlines; i++) {
+            if (memmem(history->map + history->lines[i],
+                       line_length(history, i), text, len) != NULL &&
+                print_line(history, i) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (history->nbuckets == 0) {
+        return 0;  // no line has a trigram
+    }
+    posting_t *rarest = NULL;
+    for (size_t j = 0; j + 3 <= len; j++) {
+        posting_t *posting = find_bucket(history->buckets, history->nbuckets,
+                                         trigram_at(text + j));
+        if (posting->trigram == 0) {
+            return 0;  // no line has this trigram, so none has text
+        }
+        if (rarest == NULL || posting->nlines < rarest->nlines) {
+            rarest = posting;
+        }
+    }
+    for (uint32_t k = 0; k < rarest->nlines; k++) {
+        size_t i = rarest->lines[k];
+        if (memmem(history->map + history->lines[i], line_length(history, i),
+                   text, len) != NULL &&
+            print_line(history, i) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
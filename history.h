@@ -0,0 +1,59 @@
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stddef.h>
+
+typedef struct history history_t;
+
+/*
+ * initializes the history kept in the file at path, which is created if it
+ * does not exist, returns pointer, NULL on failure
+ * the file is mapped with mmap() here, not read, so this takes the same time
+ * however long the history is; it is mapped again whenever it has grown, and
+ * the indexes are built the first time they are needed
+ */
+history_t *init_history(const char *path);
+/*
+ * cleans up history
+ * Note: this function will free the history pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_history(history_t *history);
+
+/*
+ * appends a line (len bytes, without its '\n') to the history file, in a
+ * single write() to a file opened with O_APPEND, so lines from shells sharing
+ * the file are never interleaved
+ * returns 0 on success, -1 on failure
+ */
+int add_history(history_t *history, const char *line, size_t len);
+
+/*
+ * finds the most recent line starting with the len bytes of prefix, taking in
+ * lines added by other shells
+ * lines are found through an index of how each line starts (its first one,
+ * two and three bytes): only the lines starting with the first three bytes of
+ * prefix (or all of it, if shorter) are looked at, most recent first
+ * returns the line, which is not '\0' terminated and is only valid until the
+ * history is next used, and stores its length in *line_len; NULL if there is
+ * none
+ */
+const char *find_history(history_t *history, const char *prefix, size_t len,
+                         size_t *line_len);
+
+/*
+ * history command, prints the last n lines (every line if n is 0), numbered
+ * returns 0 on success, -1 on failure
+ */
+int print_history(history_t *history, size_t n);
+
+/*
+ * history -s command, prints every line containing text, numbered, in the
+ * order they were added
+ * lines are found through an index of the trigrams (three byte substrings)
+ * each line has: only the lines with the rarest trigram of text are looked at
+ * returns 0 on success, -1 on failure
+ */
+int search_history(history_t *history, const char *text);
+
+#endif  // HISTORY_H_
@@ -1,31 +1,207 @@
 #include "./jobs.h"
+#include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
 
+// a single process belonging to a job, e.g. one stage of a pipeline
+// pidfd refers to the process for as long as it is a member, -1 if it has none
+struct job_member {
+    pid_t pid;
+    int pidfd;
+    process_state_t state;
+};
+typedef struct job_member job_member_t;
+
+// jobs live in the slots of a slab; prev and next are the slots of the jobs
+// before and after this one in the order they were added, -1 at either end
+// a free slot has in_use set to 0 and next pointing to the next free slot
+// usage adds up the resource usage of the members that have been reaped,
+// started is when the job was added (CLOCK_MONOTONIC), and timed is set if its
+// usage is to be reported once it finishes
+// launched and changed are the wall-clock times it was added and its state (or
+// a member's) last changed, for jobs -l
 struct job_element {
     int jid;
     pid_t pid;
     process_state_t state;
     char *command;
-    struct job_element *next;
+    job_member_t *members;
+    int nmembers;
+    int members_size;
+    struct rusage usage;
+    struct timespec started;
+    int timed;
+    time_t launched;
+    time_t changed;
+    int prev;
+    int next;
+    int in_use;
 };
 typedef struct job_element job_element_t;
 
-// head is the head of the list
-// current is the current element being iterated over
+// open addressing hash table from a positive int (a PID or JID) to the slot
+// of its job; a key of 0 marks an empty bucket
+// size is a power of two and the table is kept at most half full
+struct int_map {
+    int *keys;
+    int *slots;
+    size_t size;
+    size_t count;
+};
+typedef struct int_map int_map_t;
+
+// jobs is the slab of size jobs_size, and free is the first free slot in it
+// head and tail are the slots of the first and last job in the list
+// current is the slot of the job being iterated over
+// by_pid finds a job from its PID or the PID of any of its members, by_jid
+// from its JID
+// all slots are -1 when there is no such job
 struct job_list {
-    job_element_t *head;
-    job_element_t *current;
+    job_element_t *jobs;
+    int jobs_size;
+    int free;
+    int head;
+    int tail;
+    int current;
+    int_map_t by_pid;
+    int_map_t by_jid;
     pid_t shell_pid;
 };
 
+/* sets up an empty map with room for size keys */
+static void init_map(int_map_t *map, size_t size) {
+    map->keys = (int *)calloc(size, sizeof(int));
+    map->slots = (int *)malloc(sizeof(int) * size);
+    map->size = size;
+    map->count = 0;
+}
+
+/* bucket key hashes to (Fibonacci hashing) */
+static size_t map_bucket(const int_map_t *map, int key) {
+    return (size_t)((unsigned)key * 2654435769u) & (map->size - 1);
+}
+
+/* finds the bucket holding key, or the empty bucket where it would go */
+static size_t map_find(const int_map_t *map, int key) {
+    size_t i = map_bucket(map, key);
+    while (map->keys[i] != 0 && map->keys[i] != key) {
+        i = (i + 1) & (map->size - 1);
+    }
+    return i;
+}
+
+/* gets the slot stored for key, -1 if there is none */
+static int map_get(const int_map_t *map, int key) {
+    if (key <= 0) {
+        return -1;
+    }
+    size_t i = map_find(map, key);
+    return map->keys[i] == key ? map->slots[i] : -1;
+}
+
+/* stores slot for key, doubling the table when it gets half full */
+static void map_put(int_map_t *map, int key, int slot) {
+    if ((map->count + 1) * 2 > map->size) {
+        int_map_t grown;
+        init_map(&grown, map->size * 2);
+        for (size_t i = 0; i < map->size; i++) {
+            if (map->keys[i] != 0) {
+                map_put(&grown, map->keys[i], map->slots[i]);
+            }
+        }
+        free(map->keys);
+        free(map->slots);
+        *map = grown;
+    }
+    size_t i = map_find(map, key);
+    if (map->keys[i] == 0) {
+        map->count++;
+    }
+    map->keys[i] = key;
+    map->slots[i] = slot;
+}
+
+/* removes key, shifting back any keys that probed past its bucket */
+static void map_remove(int_map_t *map, int key) {
+    if (key <= 0) {
+        return;
+    }
+    size_t i = map_find(map, key);
+    if (map->keys[i] != key) {
+        return;
+    }
+    map->keys[i] = 0;
+    map->count--;
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & (map->size - 1);
+        if (map->keys[j] == 0) {
+            return;
+        }
+        size_t home = map_bucket(map, map->keys[j]);
+        // the key at j can fill the hole at i unless its home bucket lies
+        // cyclically in (i, j]
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && (home <= i && home > j))) {
+            map->keys[i] = map->keys[j];
+            map->slots[i] = map->slots[j];
+            map->keys[j] = 0;
+            i = j;
+        }
+    }
+}
+
+/* closes the pidfds of every member of a job */
+static void close_members(job_element_t *job) {
+    for (int i = 0; i < job->nmembers; i++) {
+        if (job->members[i].pidfd >= 0) {
+            close(job->members[i].pidfd);
+            job->members[i].pidfd = -1;
+        }
+    }
+}
+
+/*
+ * sends sig to a job's process group, returns 0 on success, -1 on failure
+ * a member's pidfd is checked first: while a member has not been reaped its
+ * PID, and so the job's process group ID, cannot be given to anyone else, so
+ * the signal cannot reach an unrelated process group even if the job has
+ * finished and its leader been reaped behind our back
+ * a job with no pidfds is signalled by PID alone
+ */
+static int signal_members(job_element_t *job, int sig) {
+    int checked = 0;
+    for (int i = 0; i < job->nmembers; i++) {
+        if (job->members[i].pidfd < 0) {
+            continue;
+        }
+        checked = 1;
+        if (syscall(SYS_pidfd_send_signal, job->members[i].pidfd, 0, NULL, 0) ==
+            0) {
+            // the group is ours; this also reaches processes the members
+            // started, which have no pidfds. It is asked of the member, since
+            // parallel's jobs share the group of the first one it launched
+            return kill(-getpgid(job->members[i].pid), sig);
+        }
+    }
+    return checked ? -1 : kill(-job->pid, sig);
+}
+
 /* initializes job list, returns pointer */
 job_list_t *init_job_list() {
     job_list_t *job_list = (job_list_t *)malloc(sizeof(job_list_t));
-    job_list->head = NULL;
-    job_list->current = NULL;
+    job_list->jobs = NULL;
+    job_list->jobs_size = 0;
+    job_list->free = -1;
+    job_list->head = -1;
+    job_list->tail = -1;
+    job_list->current = -1;
+    init_map(&job_list->by_pid, 16);
+    init_map(&job_list->by_jid, 16);
     job_list->shell_pid = getpid();
     return job_list;
 }
@@ -40,43 +216,81 @@ void cleanup_job_list(job_list_t *job_list) {
         return;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        job_element_t *nextElement = cur->next;
+    int cur = job_list->head;
+    while (cur != -1) {
+        job_element_t *job = &job_list->jobs[cur];
 
         // if we are cleaning up the shell's job list and not a child's
         if (getpid() == job_list->shell_pid) {
             /* kill process */
-            if (kill(-cur->pid, SIGKILL) < 0) {
+            if (signal_members(job, SIGKILL) < 0) {
                 perror("kill");
             }
         }
+        close_members(job);
 
-        if (cur->command != NULL) {
-            free(cur->command);
-            cur->command = NULL;
+        if (job->command != NULL) {
+            free(job->command);
+            job->command = NULL;
         }
+        free(job->members);
 
-        free(cur);
-        cur = nextElement;
+        cur = job->next;
     }
 
-    job_list->head = NULL;
-    job_list->current = NULL;
+    free(job_list->jobs);
+    free(job_list->by_pid.keys);
+    free(job_list->by_pid.slots);
+    free(job_list->by_jid.keys);
+    free(job_list->by_jid.slots);
+    job_list->jobs = NULL;
+    job_list->head = -1;
+    job_list->current = -1;
     job_list->shell_pid = 0;
 
     free(job_list);
 }
 
-/* adds new job to list, returns 0 on success, -1 on failure */
+/* takes a slot off the free list, doubling the slab if there is none */
+static int alloc_slot(job_list_t *job_list) {
+    if (job_list->free == -1) {
+        int size = job_list->jobs_size ? job_list->jobs_size * 2 : 16;
+        job_element_t *jobs = (job_element_t *)realloc(
+            job_list->jobs, sizeof(job_element_t) * (size_t)size);
+        if (jobs == NULL) {
+            return -1;
+        }
+        for (int i = size - 1; i >= job_list->jobs_size; i--) {
+            jobs[i].in_use = 0;
+            jobs[i].next = job_list->free;
+            job_list->free = i;
+        }
+        job_list->jobs = jobs;
+        job_list->jobs_size = size;
+    }
+    int slot = job_list->free;
+    job_list->free = job_list->jobs[slot].next;
+    return slot;
+}
+
+/*
+ * adds new job to list, returns 0 on success, -1 on failure
+ * the job's PID is its process group and becomes the job's first member
+ */
 int add_job(job_list_t *job_list, int jid, pid_t pid, process_state_t state,
             char *command) {
     if (job_list == NULL || (state != RUNNING && state != STOPPED) ||
-        command == NULL) {
+        command == NULL || jid <= 0 || pid <= 0 ||
+        map_get(&job_list->by_jid, jid) != -1 ||
+        map_get(&job_list->by_pid, pid) != -1) {
         return -1;
     }
 
-    job_element_t *new = (job_element_t *)malloc(sizeof(job_element_t));
+    int slot = alloc_slot(job_list);
+    if (slot == -1) {
+        return -1;
+    }
+    job_element_t *new = &job_list->jobs[slot];
     new->jid = jid;
     new->pid = pid;
 
@@ -87,24 +301,73 @@ int add_job(job_list_t *job_list, int jid, pid_t pid, process_state_t state,
     new->command = (char *)malloc(sizeof(char) * (cmdlen + 1));
     memcpy(new->command, command, cmdlen);
     new->command[cmdlen] = 0;
-    new->next = NULL;
-
-    if (job_list->head == NULL) {
-        // add to head
-        job_list->head = new;
-        job_list->current = new;
+    new->members = (job_member_t *)malloc(sizeof(job_member_t));
+    new->members[0].pid = pid;
+    new->members[0].pidfd = -1;
+    new->members[0].state = state;
+    new->nmembers = 1;
+    new->members_size = 1;
+    memset(&new->usage, 0, sizeof(new->usage));
+    clock_gettime(CLOCK_MONOTONIC, &new->started);
+    new->timed = 0;
+    new->launched = time(NULL);
+    new->changed = new->launched;
+    new->in_use = 1;
+
+    // add to tail
+    new->prev = job_list->tail;
+    new->next = -1;
+    if (job_list->tail == -1) {
+        job_list->head = slot;
+        job_list->current = slot;
     } else {
-        // add to tail
-        job_element_t *cur = job_list->head;
-        while (cur->next != NULL) {
-            cur = cur->next;
-        }
-        cur->next = new;
+        job_list->jobs[job_list->tail].next = slot;
     }
+    job_list->tail = slot;
+
+    map_put(&job_list->by_jid, jid, slot);
+    map_put(&job_list->by_pid, pid, slot);
 
     return 0;
 }
 
+/* unlinks the job in slot from the list and its indexes and frees the slot */
+static void remove_slot(job_list_t *job_list, int slot) {
+    job_element_t *cur = &job_list->jobs[slot];
+
+    if (cur->prev != -1) {
+        job_list->jobs[cur->prev].next = cur->next;
+    } else {
+        job_list->head = cur->next;
+    }
+    if (cur->next != -1) {
+        job_list->jobs[cur->next].prev = cur->prev;
+    } else {
+        job_list->tail = cur->prev;
+    }
+    if (job_list->current == slot) {
+        job_list->current = cur->next;
+    }
+
+    map_remove(&job_list->by_jid, cur->jid);
+    map_remove(&job_list->by_pid, cur->pid);
+    for (int i = 0; i < cur->nmembers; i++) {
+        map_remove(&job_list->by_pid, cur->members[i].pid);
+    }
+
+    if (cur->command != NULL) {
+        free(cur->command);
+        cur->command = NULL;
+    }
+    close_members(cur);
+    free(cur->members);
+    cur->members = NULL;
+
+    cur->in_use = 0;
+    cur->next = job_list->free;
+    job_list->free = slot;
+}
+
 /* removes job from list, given job's JID,
     returns 0 on success, -1 on failure */
 int remove_job_jid(job_list_t *job_list, int jid) {
@@ -112,148 +375,361 @@ int remove_job_jid(job_list_t *job_list, int jid) {
         return -1;
     }
 
-    job_element_t *prev = NULL;
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->jid == jid) {
-            if (prev != NULL) {
-                prev->next = cur->next;
-            }
-            if (job_list->head == cur) {
-                job_list->head = cur->next;
-            }
-            if (job_list->current == cur) {
-                job_list->current = cur->next;
-            }
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    remove_slot(job_list, slot);
+    return 0;
+}
 
-            if (cur->command != NULL) {
-                free(cur->command);
-                cur->command = NULL;
-            }
+/* removes job from list, given job's PID,
+    returns 0 on success, -1 on failure */
+int remove_job_pid(job_list_t *job_list, pid_t pid) {
+    if (job_list == NULL) {
+        return -1;
+    }
+
+    int slot = map_get(&job_list->by_pid, pid);
+    if (slot == -1 || job_list->jobs[slot].pid != pid) {
+        return -1;
+    }
+    remove_slot(job_list, slot);
+    return 0;
+}
+
+/* updates job's state, given job's JID, returns 0 on success, -1 on failure */
+int update_job_jid(job_list_t *job_list, int jid, process_state_t state) {
+    if (job_list == NULL) {
+        return -1;
+    }
+
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    job_list->jobs[slot].state = state;
+    job_list->jobs[slot].changed = time(NULL);
+    return 0;
+}
+
+/* updates job's state, given job's PID, returns 0 on success, -1 on failure */
+int update_job_pid(job_list_t *job_list, pid_t pid, process_state_t state) {
+    if (job_list == NULL) {
+        return -1;
+    }
+
+    int slot = map_get(&job_list->by_pid, pid);
+    if (slot == -1 || job_list->jobs[slot].pid != pid) {
+        return -1;
+    }
+    job_list->jobs[slot].state = state;
+    job_list->jobs[slot].changed = time(NULL);
+    return 0;
+}
 
-            free(cur);
-            cur = NULL;
+/*
+ * finds the job one of whose members has the given PID, returns NULL if there
+ * is none, otherwise stores the member's index in the job in *index
+ */
+static job_element_t *find_job_member(job_list_t *job_list, pid_t pid,
+                                      int *index) {
+    int slot = map_get(&job_list->by_pid, pid);
+    if (slot == -1) {
+        return NULL;
+    }
+    job_element_t *job = &job_list->jobs[slot];
+    for (int i = 0; i < job->nmembers; i++) {
+        if (job->members[i].pid == pid) {
+            *index = i;
+            return job;
+        }
+    }
+    return NULL;  // the job's own PID, after that member has gone
+}
+
+/* adds a member process to a job, given the job's JID,
+    returns 0 on success, -1 on failure */
+int add_job_member(job_list_t *job_list, int jid, pid_t pid) {
+    if (job_list == NULL || pid <= 0 || map_get(&job_list->by_pid, pid) != -1) {
+        return -1;
+    }
+
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
 
-            return 0;
+    job_element_t *job = &job_list->jobs[slot];
+    if (job->nmembers == job->members_size) {
+        int size = job->members_size * 2;
+        job_member_t *members = (job_member_t *)realloc(
+            job->members, sizeof(job_member_t) * (size_t)size);
+        if (members == NULL) {
+            return -1;
         }
+        job->members = members;
+        job->members_size = size;
+    }
+    job->members[job->nmembers].pid = pid;
+    job->members[job->nmembers].pidfd = -1;
+    job->members[job->nmembers].state = job->state;
+    job->nmembers++;
+    map_put(&job_list->by_pid, pid, slot);
+
+    return 0;
+}
 
-        prev = cur;
-        cur = cur->next;
+/* removes a member process from its job, given the member's PID,
+    returns the number of members left in the job, -1 on failure */
+int remove_job_member(job_list_t *job_list, pid_t pid) {
+    if (job_list == NULL) {
+        return -1;
     }
 
-    return -1;
+    int i;
+    job_element_t *job = find_job_member(job_list, pid, &i);
+    if (job == NULL) {
+        return -1;
+    }
+
+    if (job->members[i].pidfd >= 0) {
+        close(job->members[i].pidfd);
+    }
+    job->nmembers--;
+    job->changed = time(NULL);
+    memmove(&job->members[i], &job->members[i + 1],
+            sizeof(job_member_t) * (size_t)(job->nmembers - i));
+    // the job's own PID stays its process group, so it keeps finding the job
+    if (pid != job->pid) {
+        map_remove(&job_list->by_pid, pid);
+    }
+
+    return job->nmembers;
 }
 
-/* removes job from list, given job's PID,
+/* updates a member process's state, given the member's PID,
     returns 0 on success, -1 on failure */
-int remove_job_pid(job_list_t *job_list, pid_t pid) {
+int update_job_member(job_list_t *job_list, pid_t pid, process_state_t state) {
     if (job_list == NULL) {
         return -1;
     }
 
-    job_element_t *prev = NULL;
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->pid == pid) {
-            if (prev != NULL) {
-                prev->next = cur->next;
-            }
-            if (job_list->head == cur) {
-                job_list->head = cur->next;
-            }
-            if (job_list->current == cur) {
-                job_list->current = cur->next;
-            }
+    int i;
+    job_element_t *job = find_job_member(job_list, pid, &i);
+    if (job == NULL) {
+        return -1;
+    }
 
-            if (cur->command != NULL) {
-                free(cur->command);
-                cur->command = NULL;
-            }
-            free(cur);
-            cur = NULL;
+    job->members[i].state = state;
+    job->changed = time(NULL);
+    return 0;
+}
 
-            return 0;
-        }
+/* gives a member process a pidfd, given the member's PID, which the job list
+    then closes when the member is removed,
+    returns 0 on success, -1 on failure */
+int set_job_member_pidfd(job_list_t *job_list, pid_t pid, int pidfd) {
+    if (job_list == NULL) {
+        return -1;
+    }
 
-        prev = cur;
-        cur = cur->next;
+    int i;
+    job_element_t *job = find_job_member(job_list, pid, &i);
+    if (job == NULL) {
+        return -1;
     }
 
-    return -1;
+    if (job->members[i].pidfd >= 0) {
+        close(job->members[i].pidfd);
+    }
+    job->members[i].pidfd = pidfd;
+    return 0;
 }
 
-/* updates job's state, given job's JID, returns 0 on success, -1 on failure */
-int update_job_jid(job_list_t *job_list, int jid, process_state_t state) {
+/* gets the PID of a job's i'th member, given the job's JID, and stores the
+    member's pidfd (-1 if it has none) in *pidfd,
+    returns the PID on success, -1 if there is no such member */
+pid_t get_job_member(job_list_t *job_list, int jid, int i, int *pidfd) {
     if (job_list == NULL) {
         return -1;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->jid == jid) {
-            cur->state = state;
-            return 0;
-        }
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1 || i < 0 || i >= job_list->jobs[slot].nmembers) {
+        return -1;
+    }
+    *pidfd = job_list->jobs[slot].members[i].pidfd;
+    return job_list->jobs[slot].members[i].pid;
+}
 
-        cur = cur->next;
+/* sends a signal to a job, given the job's JID,
+    returns 0 on success, -1 on failure */
+int signal_job(job_list_t *job_list, int jid, int sig) {
+    if (job_list == NULL) {
+        return -1;
     }
 
-    return -1;
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    return signal_members(&job_list->jobs[slot], sig);
 }
 
-/* updates job's state, given job's PID, returns 0 on success, -1 on failure */
-int update_job_pid(job_list_t *job_list, pid_t pid, process_state_t state) {
+/* has a job's resource usage reported once it finishes, given the job's JID,
+    returns 0 on success, -1 on failure */
+int time_job(job_list_t *job_list, int jid) {
     if (job_list == NULL) {
         return -1;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->pid == pid) {
-            cur->state = state;
-            return 0;
-        }
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    job_list->jobs[slot].timed = 1;
+    return 0;
+}
 
-        cur = cur->next;
+/* adds a reaped process's resource usage to its job's, given the process's
+    PID, returns 0 on success, -1 on failure
+    max RSS is the largest of any member's, everything else is summed */
+int add_job_usage(job_list_t *job_list, pid_t pid, const struct rusage *usage) {
+    if (job_list == NULL || usage == NULL) {
+        return -1;
     }
 
-    return -1;
+    int slot = map_get(&job_list->by_pid, pid);
+    if (slot == -1) {
+        return -1;
+    }
+    struct rusage *total = &job_list->jobs[slot].usage;
+    timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+    timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+    if (usage->ru_maxrss > total->ru_maxrss) {
+        total->ru_maxrss = usage->ru_maxrss;
+    }
+    total->ru_minflt += usage->ru_minflt;
+    total->ru_majflt += usage->ru_majflt;
+    total->ru_nvcsw += usage->ru_nvcsw;
+    total->ru_nivcsw += usage->ru_nivcsw;
+    return 0;
 }
 
-/* gets PID of job, given job's JID, returns PID on success, -1 on failure */
-pid_t get_job_pid(job_list_t *job_list, int jid) {
+/* prints a time in seconds the way time does, as <minutes>m<seconds>s */
+static int print_seconds(const char *name, long sec, long usec) {
+    return fprintf(stderr, "%s\t%ldm%ld.%03lds\n", name, sec / 60, sec % 60,
+                   usec / 1000);
+}
+
+/*
+ * prints resource usage to stderr: wall-clock time elapsed, user and system
+ * CPU time, max RSS, context switches and page faults
+ * returns 0 on success, -1 on failure
+ */
+int print_usage(const struct rusage *usage, const struct timespec *elapsed) {
+    if (print_seconds("real", (long)elapsed->tv_sec, elapsed->tv_nsec / 1000) <
+            0 ||
+        print_seconds("user", (long)usage->ru_utime.tv_sec,
+                      (long)usage->ru_utime.tv_usec) < 0 ||
+        print_seconds("sys", (long)usage->ru_stime.tv_sec,
+                      (long)usage->ru_stime.tv_usec) < 0 ||
+        fprintf(stderr, "maxrss\t%ld KiB\n", usage->ru_maxrss) < 0 ||
+        fprintf(stderr, "ctxsw\t%ld voluntary, %ld involuntary\n",
+                usage->ru_nvcsw, usage->ru_nivcsw) < 0 ||
+        fprintf(stderr, "faults\t%ld minor, %ld major\n", usage->ru_minflt,
+                usage->ru_majflt) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* prints the resource usage of a finished job (see print_usage) if it is
+    timed, given the job's JID; real is the time since it was added,
+    returns 1 if it was printed, 0 if the job is not timed, -1 on failure */
+int report_job_usage(job_list_t *job_list, int jid) {
+    if (job_list == NULL) {
+        return -1;
+    }
+
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    job_element_t *job = &job_list->jobs[slot];
+    if (!job->timed) {
+        return 0;
+    }
+    struct timespec now, elapsed;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed.tv_sec = now.tv_sec - job->started.tv_sec;
+    elapsed.tv_nsec = now.tv_nsec - job->started.tv_nsec;
+    if (elapsed.tv_nsec < 0) {
+        elapsed.tv_sec--;
+        elapsed.tv_nsec += 1000000000L;
+    }
+    return print_usage(&job->usage, &elapsed) < 0 ? -1 : 1;
+}
+
+/* counts the members of a job in the given state, given the job's JID,
+    returns the count on success, -1 on failure */
+int count_job_members(job_list_t *job_list, int jid, process_state_t state) {
     if (job_list == NULL) {
         return -1;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->jid == jid) {
-            return cur->pid;
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+
+    job_element_t *job = &job_list->jobs[slot];
+    int count = 0;
+    for (int i = 0; i < job->nmembers; i++) {
+        if (job->members[i].state == state) {
+            count++;
         }
+    }
+    return count;
+}
 
-        cur = cur->next;
+/* gets PID of job, given job's JID, returns PID on success, -1 on failure */
+pid_t get_job_pid(job_list_t *job_list, int jid) {
+    if (job_list == NULL) {
+        return -1;
     }
 
-    return -1;
+    int slot = map_get(&job_list->by_jid, jid);
+    return slot == -1 ? -1 : job_list->jobs[slot].pid;
 }
 
-/* gets JID of job, given job's PID, returns JID on success, -1 on failure */
-int get_job_jid(job_list_t *job_list, pid_t pid) {
+/* gets the process group of a job, given its JID: that of its first member,
+    which is its PID unless parallel launched it into its pool's group,
+    returns the group on success, -1 on failure */
+pid_t get_job_pgid(job_list_t *job_list, int jid) {
     if (job_list == NULL) {
         return -1;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        if (cur->pid == pid) {
-            return cur->jid;
-        }
+    int slot = map_get(&job_list->by_jid, jid);
+    if (slot == -1) {
+        return -1;
+    }
+    job_element_t *job = &job_list->jobs[slot];
+    pid_t pgid = job->nmembers > 0 ? getpgid(job->members[0].pid) : -1;
+    return pgid > 0 ? pgid : job->pid;
+}
 
-        cur = cur->next;
+/* gets JID of job, given the PID of any of its members,
+    returns JID on success, -1 on failure */
+int get_job_jid(job_list_t *job_list, pid_t pid) {
+    if (job_list == NULL) {
+        return -1;
     }
 
-    return -1;
+    int slot = map_get(&job_list->by_pid, pid);
+    return slot == -1 ? -1 : job_list->jobs[slot].jid;
 }
 
 /*
@@ -267,12 +743,12 @@ pid_t get_next_pid(job_list_t *job_list) {  // circular iterator
         return -1;
     }
 
-    if (job_list->current == NULL) {
+    if (job_list->current == -1) {
         job_list->current = job_list->head;
         return -1;
     } else {
-        pid_t pid = job_list->current->pid;
-        job_list->current = job_list->current->next;
+        pid_t pid = job_list->jobs[job_list->current].pid;
+        job_list->current = job_list->jobs[job_list->current].next;
         return pid;
     }
 }
@@ -283,15 +759,105 @@ void jobs(job_list_t *job_list) {
         return;
     }
 
-    job_element_t *cur = job_list->head;
-    while (cur != NULL) {
-        char *state_string = cur->state == RUNNING ? "Running" : "Stopped";
-        if (printf("[%d] (%d) %s %s\n", cur->jid, cur->pid, state_string,
-                   cur->command) < 0) {
+    int cur = job_list->head;
+    while (cur != -1) {
+        job_element_t *job = &job_list->jobs[cur];
+        char *state_string = job->state == RUNNING ? "Running" : "Stopped";
+        if (printf("[%d] (%d) %s %s\n", job->jid, job->pid, state_string,
+                   job->command) < 0) {
+            fprintf(stderr, "error printing jobs list\n");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        cur = job->next;
+    }
+}
+
+/*
+ * reads the CPU time (in clock ticks), RSS (in pages) and thread count of a
+ * live process from /proc/<pid>/stat, adding them to the given totals
+ * returns 0 on success, -1 if the process could not be read
+ */
+static int add_proc_stat(pid_t pid, unsigned long *ticks, long *pages,
+                         long *threads) {
+    char path[32], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    // the command name is in parentheses and may itself contain them, so the
+    // fields are counted from the last one, starting at field 3 (state)
+    char *fields = strrchr(buf, ')');
+    unsigned long utime, stime;
+    long nthreads, rss;
+    if (fields == NULL ||
+        sscanf(fields + 1,
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d "
+               "%*d %*d %ld %*d %*u %*u %ld",
+               &utime, &stime, &nthreads, &rss) != 4) {
+        return -1;
+    }
+    *ticks += utime + stime;
+    *pages += rss;
+    *threads += nthreads;
+    return 0;
+}
+
+/* prints a wall-clock time as HH:MM:SS, returns what printf does */
+static int print_clock(const char *name, time_t t) {
+    struct tm tm;
+    char clock[16];
+    if (localtime_r(&t, &tm) == NULL ||
+        strftime(clock, sizeof(clock), "%H:%M:%S", &tm) == 0) {
+        return printf(" %s ?", name);
+    }
+    return printf(" %s %s", name, clock);
+}
+
+/*
+ * jobs -l command, prints out the jobs list with each job's resource usage:
+ * CPU time (of its live members from /proc, plus that of the members already
+ * reaped), current RSS and thread count of its live members, and when it was
+ * started and last changed state
+ */
+void jobs_long(job_list_t *job_list) {
+    if (job_list == NULL) {
+        return;
+    }
+
+    long tick = sysconf(_SC_CLK_TCK), page_kib = sysconf(_SC_PAGESIZE) / 1024;
+    int cur = job_list->head;
+    while (cur != -1) {
+        job_element_t *job = &job_list->jobs[cur];
+        char *state_string = job->state == RUNNING ? "Running" : "Stopped";
+        unsigned long ticks = 0;
+        long pages = 0, threads = 0;
+        for (int i = 0; i < job->nmembers; i++) {
+            add_proc_stat(job->members[i].pid, &ticks, &pages, &threads);
+        }
+        // reaped members' CPU time, in milliseconds, plus the live ones'
+        long ms =
+            (job->usage.ru_utime.tv_sec + job->usage.ru_stime.tv_sec) * 1000L +
+            (job->usage.ru_utime.tv_usec + job->usage.ru_stime.tv_usec) /
+                1000L +
+            (long)(ticks * 1000UL / (unsigned long)tick);
+        if (printf("[%d] (%d) %s %s\n    cpu %ldm%ld.%03lds rss %ld KiB "
+                   "threads %ld",
+                   job->jid, job->pid, state_string, job->command, ms / 60000,
+                   ms / 1000 % 60, ms % 1000, pages * page_kib, threads) < 0 ||
+            print_clock("started", job->launched) < 0 ||
+            print_clock("changed", job->changed) < 0 || printf("\n") < 0) {
             fprintf(stderr, "error printing jobs list\n");
             cleanup_job_list(job_list);
             exit(1);
         }
-        cur = cur->next;
+        cur = job->next;
     }
 }
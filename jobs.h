@@ -1,7 +1,10 @@
 #ifndef JOBS_H_
 #define JOBS_H_
 
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 typedef enum { RUNNING, STOPPED } process_state_t;
@@ -17,7 +20,10 @@ job_list_t *init_job_list();
  */
 void cleanup_job_list(job_list_t *job_list);
 
-/* adds new job to list, returns 0 on success, -1 on failure */
+/*
+ * adds new job to list, returns 0 on success, -1 on failure
+ * the job's PID is its process group and becomes the job's first member
+ */
 int add_job(job_list_t *job_list, int jid, pid_t pid, process_state_t state,
             char *command);
 
@@ -33,9 +39,55 @@ int update_job_jid(job_list_t *job_list, int jid, process_state_t state);
 /* updates job's state, given job's PID, returns 0 on success, -1 on failure */
 int update_job_pid(job_list_t *job_list, pid_t pid, process_state_t state);
 
+/* adds a member process to a job, given the job's JID,
+        returns 0 on success, -1 on failure */
+int add_job_member(job_list_t *job_list, int jid, pid_t pid);
+/* removes a member process from its job, given the member's PID,
+        returns the number of members left in the job, -1 on failure */
+int remove_job_member(job_list_t *job_list, pid_t pid);
+/* updates a member process's state, given the member's PID,
+        returns 0 on success, -1 on failure */
+int update_job_member(job_list_t *job_list, pid_t pid, process_state_t state);
+/* gives a member process a pidfd, given the member's PID, which the job list
+        then closes when the member is removed,
+        returns 0 on success, -1 on failure */
+int set_job_member_pidfd(job_list_t *job_list, pid_t pid, int pidfd);
+/* gets the PID of a job's i'th member, given the job's JID, and stores the
+        member's pidfd (-1 if it has none) in *pidfd,
+        returns the PID on success, -1 if there is no such member */
+pid_t get_job_member(job_list_t *job_list, int jid, int i, int *pidfd);
+/* sends a signal to a job, given the job's JID,
+        returns 0 on success, -1 on failure */
+int signal_job(job_list_t *job_list, int jid, int sig);
+/* has a job's resource usage reported once it finishes, given the job's JID,
+        returns 0 on success, -1 on failure */
+int time_job(job_list_t *job_list, int jid);
+/* adds a reaped process's resource usage to its job's, given the process's
+        PID, returns 0 on success, -1 on failure
+        max RSS is the largest of any member's, everything else is summed */
+int add_job_usage(job_list_t *job_list, pid_t pid, const struct rusage *usage);
+/*
+ * prints resource usage to stderr: wall-clock time elapsed, user and system
+ * CPU time, max RSS, context switches and page faults
+ * returns 0 on success, -1 on failure
+ */
+int print_usage(const struct rusage *usage, const struct timespec *elapsed);
+/* prints the resource usage of a finished job (see print_usage) if it is
+        timed, given the job's JID; real is the time since it was added,
+        returns 1 if it was printed, 0 if the job is not timed, -1 on failure */
+int report_job_usage(job_list_t *job_list, int jid);
+/* counts the members of a job in the given state, given the job's JID,
+        returns the count on success, -1 on failure */
+int count_job_members(job_list_t *job_list, int jid, process_state_t state);
+
 /* gets PID of job, given job's JID, returns PID on success, -1 on failure */
 pid_t get_job_pid(job_list_t *job_list, int jid);
-/* gets JID of job, given job's PID, returns JID on success, -1 on failure */
+/* gets the process group of a job, given its JID: that of its first member,
+    which is its PID unless parallel launched it into its pool's group,
+    returns the group on success, -1 on failure */
+pid_t get_job_pgid(job_list_t *job_list, int jid);
+/* gets JID of job, given the PID of any of its members,
+        returns JID on success, -1 on failure */
 int get_job_jid(job_list_t *job_list, pid_t pid);
 
 /*
@@ -48,5 +100,12 @@ pid_t get_next_pid(job_list_t *job_list);
 
 /* jobs command, prints out the jobs list */
 void jobs(job_list_t *job_list);
+/*
+ * jobs -l command, prints out the jobs list with each job's resource usage:
+ * CPU time (of its live members from /proc, plus that of the members already
+ * reaped), current RSS and thread count of its live members, and when it was
+ * started and last changed state
+ */
+void jobs_long(job_list_t *job_list);
 
 #endif  // JOBS_H_
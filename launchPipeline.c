@@ -0,0 +1,272 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "affinity.h"
+#include "arena.h"
+#include "jobs.h"
+#include "pathcache.h"
+#include "rlimits.h"
+#include "spawn.h"
+
+// Works out how much of the kernel's ARG_MAX an exec of argv with envp takes
+// up: every string with its '\0' and the pointer to it, counting the
+// environment, which is passed along the same way. Returns the number of bytes
+static size_t execSize(char **argv, char *const *envp) {
+    size_t size = 0;
+    for (char **a = argv; *a != NULL; a++) size += strlen(*a) + 1 + sizeof(*a);
+    for (char *const *e = envp ? envp : environ; *e != NULL; e++)
+        size += strlen(*e) + 1 + sizeof(*e);
+    return size;
+}
+
+// Puts the body of a here-document or here-string where the child can read it
+// from: a pipe if it fits in the pipe's buffer, so that writing it never
+// blocks, or a memfd otherwise. Either way nothing touches the filesystem, and
+// the fd is close-on-exec; the child gets its own copy through its fd plan.
+// Returns the fd to read the body from, -1 on failure
+static int bodyFd(const char *body) {
+    size_t len = strlen(body);
+    int fd;
+    if (len <= PIPE_BUF) {
+        int pipefd[2];
+        if (pipe2(pipefd, O_CLOEXEC) < 0) return -1;
+        if (write(pipefd[1], body, len) != (ssize_t)len) {
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return -1;
+        }
+        close(pipefd[1]);
+        return pipefd[0];
+    }
+    if ((fd = memfd_create("heredoc", MFD_CLOEXEC)) < 0) return -1;
+    for (size_t done = 0; done < len;) {
+        ssize_t n = write(fd, body + done, len - done);
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Closes the shell's end of every here-document among the first n steps of a
+// fd plan
+static void closeBodies(const spawn_redirect_t *redirects, int n) {
+    for (int i = 0; i < n; i++)
+        if (redirects[i].shell) close(redirects[i].from);
+}
+
+// Spawns the child for one stage of a pipeline, joining process group pgid
+// (0 for a new one) with in and out as its stdin and stdout, and the stage's
+// own redirects on top of those, in the order they were given. The child puts
+// itself in placement and sets rlimits on itself before it execs with envp
+// (NULL for the shell's own environment). Commands
+// without a '/' are looked up on PATH. The child's pidfd is stored in *pidfd,
+// and its fd plan is compiled into arena; only the child carries it out. The
+// bodies of here-documents are only put in fds once the command is found, and
+// closed again once the child has its copies.
+// Returns the child's PID, 0 if the command was not found (or a body could not
+// be set up), -1 on failure
+static pid_t spawnStage(stage_t *stage, pid_t pgid, int background, int in,
+                        int out, const rlimits_t *rlimits,
+                        const placement_t *placement, char *const *envp,
+                        path_cache_t *path_cache, int *pidfd, arena_t *arena) {
+    char *command = stage->tokens[commandIndex(stage->redirects)];
+    spawn_redirect_t *redirects;
+    spawn_plan_t plan;
+    int n = 0;
+    if ((plan.path = path_lookup(path_cache, command)) == NULL) {
+        if (fprintf(stderr, "%s: command not found\n", command) < 0) {
+            perror("Error printing command not found error");
+        }
+        return 0;
+    }
+    while (stage->redirects[n] != -1) n++;
+    // &> and &>> take two steps each
+    if ((redirects = arena_alloc(arena, sizeof(spawn_redirect_t) *
+                                            (size_t)(n ? 2 * n : 1))) == NULL)
+        return -1;
+    n = 0;
+    for (int j = 0; stage->redirects[j] != -1; j++, n++) {
+        token_type_t type = stage->types[stage->redirects[j]];
+        redirects[n].path = stage->tokens[stage->redirects[j] + 1];
+        redirects[n].fd = stage->fds[stage->redirects[j]];
+        redirects[n].from = -1;
+        redirects[n].shell = 0;
+        switch (type) {
+            case TOKEN_IN:
+                redirects[n].flags = O_RDONLY;
+                break;
+            case TOKEN_OUT:
+            case TOKEN_BOTH:
+                redirects[n].flags = O_RDWR | O_CREAT | O_TRUNC;
+                break;
+            case TOKEN_DUP:
+                redirects[n].from = redirects[n].path[0] - '0';
+                redirects[n].path = NULL;
+                redirects[n].flags = 0;
+                break;
+            case TOKEN_HEREDOC:
+            case TOKEN_HERESTRING:
+                if ((redirects[n].from = bodyFd(redirects[n].path)) < 0) {
+                    perror("Error creating here-document");
+                    closeBodies(redirects, n);
+                    return 0;
+                }
+                redirects[n].path = NULL;
+                redirects[n].flags = 0;
+                redirects[n].shell = 1;
+                break;
+            default:
+                redirects[n].flags = O_RDWR | O_CREAT | O_APPEND;
+        }
+        if (type == TOKEN_BOTH || type == TOKEN_BOTH_APPEND) {
+            // then stderr goes wherever stdout now does
+            n++;
+            redirects[n].path = NULL;
+            redirects[n].flags = 0;
+            redirects[n].fd = STDERR_FILENO;
+            redirects[n].from = STDOUT_FILENO;
+            redirects[n].shell = 0;
+        }
+    }
+    plan.argv = stage->argv;
+    plan.pgid = pgid;
+    plan.foreground = !background;
+    plan.in = in;
+    plan.out = out;
+    plan.redirects = redirects;
+    plan.nredirects = n;
+    plan.cpus = placement->pinned ? &placement->cpus : NULL;
+    plan.mem_nodes = placement->mem_nodes;
+    plan.limits = rlimits->limits;
+    plan.nlimits = rlimits->nlimits;
+    plan.envp = envp;
+    plan.pidfd = pidfd;
+    pid_t pid = spawn_process(&plan);
+    int err = errno;
+    closeBodies(redirects, n);
+    errno = err;
+    return pid;
+}
+
+// Launches every stage of a pipeline in its own child, connecting each stage's
+// stdout to the next stage's stdin. The children share one process group, group
+// if it is not 0 (parallel launches its jobs into one group, so that the
+// terminal can be handed to all of them), otherwise a new one led by the first
+// stage, and are added to the job list as the single job jid, each
+// with the pidfd it was spawned with. Every stage is launched with rlimits, in
+// placement, with the environment envp.
+// Returns 0 on success, -1 if nothing was launched, either because the
+// redirects in the pipeline do not make sense, a stage's arguments are over
+// ARG_MAX or no command in it was found
+int launchPipeline(stage_t *stages, int nstages, int background, pid_t group,
+                   const rlimits_t *rlimits, const placement_t *placement,
+                   char *const *envp, int jid, job_list_t *job_list,
+                   path_cache_t *path_cache, arena_t *arena) {
+    for (int i = 0; i < nstages; i++) {
+        // only the ends of the pipeline have a stdin or stdout to redirect
+        for (int j = 0; stages[i].redirects[j] != -1; j++) {
+            int fd = stages[i].fds[stages[i].redirects[j]];
+            if ((fd == STDIN_FILENO && i != 0) ||
+                (fd == STDOUT_FILENO && i != nstages - 1)) {
+                if (fprintf(stderr,
+                            "syntax error: redirect inside a pipeline\n") < 0) {
+                    perror("Error printing redirect inside a pipeline error");
+                    cleanup_job_list(job_list);
+                    exit(1);
+                }
+                return -1;
+            }
+        }
+    }
+    for (int i = 0; i < nstages; i++) {
+        if (execSize(stages[i].argv, envp) > (size_t)sysconf(_SC_ARG_MAX)) {
+            if (fprintf(stderr, "%s: argument list too long\n",
+                        stages[i].tokens[commandIndex(stages[i].redirects)]) <
+                0) {
+                perror("Error printing argument list too long error");
+                cleanup_job_list(job_list);
+                exit(1);
+            }
+            return -1;
+        }
+    }
+    pid_t pgid = group;
+    int added = 0;  // whether any stage was launched, and so the job added
+    int in = -1;    // read end of the pipe from the previous stage
+    // anything the shell printed goes out before the job's own output
+    if (fflush(stdout) < 0) {
+        perror("Error flushing stdout");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    for (int i = 0; i < nstages; i++) {
+        int pipefd[2] = {-1, -1};
+        if (i < nstages - 1 && pipe2(pipefd, O_CLOEXEC) < 0) {
+            perror("pipe2");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        int pidfd = -1;
+        pid_t pid =
+            spawnStage(&stages[i], pgid, background, in, pipefd[1], rlimits,
+                       placement, envp, path_cache, &pidfd, arena);
+        if (pid < 0) {
+            perror("clone");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        if (!pid) {
+            // not found; its neighbours just see the pipes close
+        } else if (!added) {
+            if (!pgid) pgid = pid;
+            added = 1;
+            add_job(job_list, jid, pid, RUNNING,
+                    stages[0].tokens[commandIndex(stages[0].redirects)]);
+        } else {
+            add_job_member(job_list, jid, pid);
+        }
+        if (pid > 0) set_job_member_pidfd(job_list, pid, pidfd);
+        if (in != -1) close(in);
+        if (pipefd[1] != -1) close(pipefd[1]);
+        in = pipefd[0];
+    }
+    return added ? 0 : -1;
+}
+
+// Launches a pipeline as job jid, then either reports it as a background job
+// or waits on it in the foreground. If timed is set, the job's resource usage
+// is reported once it finishes, whenever that is. The job is launched with
+// rlimits, in placement, with the environment envp. The status of a job waited
+// for in the foreground is stored in *status, 0 for one in the background and
+// 127 if nothing could be launched. Returns the JID to use for the next job,
+// which is only advanced if the job stays on the job list
+int launchJob(stage_t *stages, int nstages, int background, int timed,
+              const rlimits_t *rlimits, const placement_t *placement,
+              char *const *envp, int jid, job_list_t *job_list,
+              path_cache_t *path_cache, arena_t *arena, int *status) {
+    *status = 127;
+    if (launchPipeline(stages, nstages, background, 0, rlimits, placement, envp,
+                       jid, job_list, path_cache, arena) == -1)
+        return jid;
+    if (timed) time_job(job_list, jid);
+    if (!background) return jid + waitForeground(job_list, jid, status);
+    *status = 0;
+    if (printf("[%d] (%d)\n", jid, get_job_pid(job_list, jid)) < 0) {
+        perror("Error add job print");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    return jid + 1;
+}
@@ -0,0 +1,283 @@
+#include "./linereader.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// size of the buffer to start with; it doubles whenever a single line does
+// not fit, up to room for a line of ARG_MAX bytes
+#define LINE_READER_SIZE 1024
+
+// buf holds size bytes, of which start to end have been read but not yet
+// handed out as lines
+// eof is set once a read has returned 0
+// mapped is the length of the mapping if buf is a mapped file, 0 otherwise
+// owned is set if fd was opened by the reader itself, which then closes it
+// limit is the longest line handed out (ARG_MAX); of a longer one, skipped
+// counts the bytes thrown away so far, skipping is set until its '\n' has been
+// read, and dropped is its length once next_line() has handed it out as empty
+struct line_reader {
+    int fd;
+    int owned;
+    char *buf;
+    size_t size;
+    size_t start;
+    size_t end;
+    int eof;
+    size_t mapped;
+    size_t limit;
+    size_t skipped;
+    int skipping;
+    size_t dropped;
+};
+
+/* initializes a line reader on fd, returns pointer */
+line_reader_t *init_line_reader(int fd) {
+    line_reader_t *line_reader = (line_reader_t *)malloc(sizeof(line_reader_t));
+    line_reader->fd = fd;
+    line_reader->owned = 0;
+    line_reader->buf = (char *)malloc(LINE_READER_SIZE);
+    line_reader->size = LINE_READER_SIZE;
+    line_reader->start = 0;
+    line_reader->end = 0;
+    line_reader->eof = 0;
+    line_reader->mapped = 0;
+    line_reader->limit = (size_t)sysconf(_SC_ARG_MAX);
+    line_reader->skipped = 0;
+    line_reader->skipping = 0;
+    line_reader->dropped = 0;
+    return line_reader;
+}
+
+/*
+ * initializes a line reader on the whole of the file at path, returns pointer,
+ * NULL on failure
+ * a regular file is mapped with mmap() rather than read, and its lines are
+ * handed out in place; the mapping is private and lines are '\0' terminated
+ * (and lexed) in place, so each page is copied by the kernel the first time it
+ * is written to, rather than the whole file being read through a buffer
+ * anything else (a pipe, a FIFO such as <(...), /dev/stdin, a /proc file),
+ * whose size says nothing about what it holds, is read like init_line_reader()
+ * reads an fd; that fd is the reader's, and cleanup_line_reader() closes it
+ */
+line_reader_t *init_line_reader_file(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        line_reader_t *line_reader = init_line_reader(fd);
+        line_reader->owned = 1;
+        return line_reader;
+    }
+
+    // the file is mapped privately so lines can be split in place, on top of
+    // an anonymous mapping one byte longer: the '\0' ending a last line
+    // without a '\n' then always has somewhere to go
+    size_t size = (size_t)st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapped = (size + 1 + page - 1) / page * page;
+    char *buf = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (size > 0 && mmap(buf, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(buf, mapped);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    madvise(buf, mapped, MADV_SEQUENTIAL);
+
+    line_reader_t *line_reader = (line_reader_t *)malloc(sizeof(line_reader_t));
+    line_reader->fd = -1;
+    line_reader->owned = 0;
+    line_reader->buf = buf;
+    line_reader->size = mapped;
+    line_reader->start = 0;
+    line_reader->end = size;
+    line_reader->eof = 1;
+    line_reader->mapped = mapped;
+    line_reader->limit = (size_t)sysconf(_SC_ARG_MAX);
+    line_reader->skipped = 0;
+    line_reader->skipping = 0;
+    line_reader->dropped = 0;
+    return line_reader;
+}
+
+/*
+ * cleans up line reader
+ * Note: this function will free the line_reader pointer and does not close fd
+ * (a file mapped by init_line_reader_file() is unmapped, and one it reads is
+ * closed)
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_line_reader(line_reader_t *line_reader) {
+    if (line_reader == NULL) {
+        return;
+    }
+
+    if (line_reader->mapped) {
+        munmap(line_reader->buf, line_reader->mapped);
+    } else {
+        free(line_reader->buf);
+    }
+    if (line_reader->owned) {
+        close(line_reader->fd);
+    }
+    free(line_reader);
+}
+
+/*
+ * gets the next complete line out of what has already been read, without
+ * reading anything more
+ * returns the line with its '\n' replaced by '\0' and stores its length in
+ * *len, or NULL if no complete line is buffered
+ * once the fd has reached end of file, a last line without a '\n' counts as
+ * complete
+ * a line longer than ARG_MAX is handed out as an empty one, and
+ * dropped_line() then gives its length
+ */
+char *next_line(line_reader_t *line_reader, size_t *len) {
+    if (line_reader == NULL) {
+        return NULL;
+    }
+    line_reader->dropped = 0;
+    if (line_reader->skipped > 0 && !line_reader->skipping) {
+        // fill_line_reader() has read up to the '\n' (or the end of file) of
+        // a line too long to keep, and left that '\n' at start
+        char *line = line_reader->buf + line_reader->start;
+        if (line_reader->start < line_reader->end) {
+            line_reader->start++;
+        }
+        *line = '\0';
+        *len = 0;
+        line_reader->dropped = line_reader->skipped;
+        line_reader->skipped = 0;
+        return line;
+    }
+    if (line_reader->start == line_reader->end) {
+        return NULL;
+    }
+
+    char *line = line_reader->buf + line_reader->start;
+    size_t avail = line_reader->end - line_reader->start;
+    char *nl = memchr(line, '\n', avail);
+    if (nl == NULL) {
+        if (!line_reader->eof) {
+            return NULL;
+        }
+        // fill_line_reader() always leaves room for this '\0'
+        nl = line + avail;
+    }
+    *nl = '\0';
+    *len = (size_t)(nl - line);
+    line_reader->start += *len + (*len < avail ? 1 : 0);
+    if (*len > line_reader->limit) {  // only a mapped file holds one whole
+        line_reader->dropped = *len;
+        *line = '\0';
+        *len = 0;
+    }
+    return line;
+}
+
+/*
+ * returns the length of the line the last next_line() handed out as empty for
+ * being longer than ARG_MAX, 0 if that line was kept
+ */
+size_t dropped_line(const line_reader_t *line_reader) {
+    return line_reader == NULL ? 0 : line_reader->dropped;
+}
+
+/*
+ * reads once from the fd, keeping any partial line at the end of the buffer
+ * so that the rest of it is appended to it
+ * returns the number of bytes read, 0 at end of file, -1 on failure
+ * Note: lines returned by next_line() before this call are no longer valid
+ */
+ssize_t fill_line_reader(line_reader_t *line_reader) {
+    if (line_reader == NULL) {
+        return -1;
+    }
+    if (line_reader->eof) {  // includes mapped files, which are read already
+        return 0;
+    }
+
+    // carry the partial line over to the front of the buffer
+    size_t partial = line_reader->end - line_reader->start;
+    if (line_reader->start > 0) {
+        memmove(line_reader->buf, line_reader->buf + line_reader->start,
+                partial);
+        line_reader->start = 0;
+        line_reader->end = partial;
+    }
+    // a line that fills the whole buffer makes it grow, up to room for a line
+    // of limit bytes and its '\n'; one byte is always kept free for the '\0'
+    // that ends a last line without a '\n'. A line that outgrows that is
+    // thrown away as it is read, up to its '\n'
+    if (line_reader->end + 1 >= line_reader->size) {
+        size_t most = line_reader->limit + 2;
+        if (line_reader->size >= most) {
+            line_reader->skipped += line_reader->end;
+            line_reader->skipping = 1;
+            line_reader->end = 0;
+        } else {
+            size_t size =
+                line_reader->size * 2 < most ? line_reader->size * 2 : most;
+            char *buf = (char *)realloc(line_reader->buf, size);
+            if (buf == NULL) {
+                return -1;
+            }
+            line_reader->buf = buf;
+            line_reader->size = size;
+        }
+    }
+
+    char *read_to = line_reader->buf + line_reader->end;
+    ssize_t n = read(line_reader->fd, read_to,
+                     line_reader->size - line_reader->end - 1);
+    if (n > 0) {
+        line_reader->end += (size_t)n;
+    } else if (n == 0) {
+        line_reader->eof = 1;
+        line_reader->skipping = 0;  // the line ends with the file
+    }
+    if (n > 0 && line_reader->skipping) {
+        char *nl = memchr(read_to, '\n', (size_t)n);
+        if (nl == NULL) {
+            line_reader->skipped += (size_t)n;
+            line_reader->end = 0;
+        } else {
+            line_reader->skipped += (size_t)(nl - read_to);
+            line_reader->start = (size_t)(nl - line_reader->buf);
+            line_reader->skipping = 0;
+        }
+    }
+    return n;
+}
+
+/*
+ * gets the next line, reading as many times as it takes to complete it
+ * returns NULL at end of file or on a read error, otherwise the same as
+ * next_line()
+ */
+char *read_line(line_reader_t *line_reader, size_t *len) {
+    char *line;
+    while ((line = next_line(line_reader, len)) == NULL) {
+        if (line_reader == NULL || line_reader->eof ||
+            fill_line_reader(line_reader) < 0) {
+            return NULL;
+        }
+    }
+    return line;
+}
@@ -0,0 +1,64 @@
+#ifndef LINEREADER_H_
+#define LINEREADER_H_
+
+#include <sys/types.h>
+
+typedef struct line_reader line_reader_t;
+
+/* initializes a line reader on fd, returns pointer */
+line_reader_t *init_line_reader(int fd);
+/*
+ * initializes a line reader on the whole of the file at path, returns pointer,
+ * NULL on failure
+ * a regular file is mapped with mmap() rather than read, and its lines are
+ * handed out in place; the mapping is private and lines are '\0' terminated
+ * (and lexed) in place, so each page is copied by the kernel the first time it
+ * is written to, rather than the whole file being read through a buffer
+ * anything else (a pipe, a FIFO such as <(...), /dev/stdin, a /proc file),
+ * whose size says nothing about what it holds, is read like init_line_reader()
+ * reads an fd; that fd is the reader's, and cleanup_line_reader() closes it
+ */
+line_reader_t *init_line_reader_file(const char *path);
+/*
+ * cleans up line reader
+ * Note: this function will free the line_reader pointer and does not close fd
+ * (a file mapped by init_line_reader_file() is unmapped, and one it reads is
+ * closed)
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_line_reader(line_reader_t *line_reader);
+
+/*
+ * gets the next complete line out of what has already been read, without
+ * reading anything more
+ * returns the line with its '\n' replaced by '\0' and stores its length in
+ * *len, or NULL if no complete line is buffered
+ * once the fd has reached end of file, a last line without a '\n' counts as
+ * complete
+ * a line longer than ARG_MAX is handed out as an empty one, and
+ * dropped_line() then gives its length
+ */
+char *next_line(line_reader_t *line_reader, size_t *len);
+
+/*
+ * returns the length of the line the last next_line() handed out as empty for
+ * being longer than ARG_MAX, 0 if that line was kept
+ */
+size_t dropped_line(const line_reader_t *line_reader);
+
+/*
+ * reads once from the fd, keeping any partial line at the end of the buffer
+ * so that the rest of it is appended to it
+ * returns the number of bytes read, 0 at end of file, -1 on failure
+ * Note: lines returned by next_line() before this call are no longer valid
+ */
+ssize_t fill_line_reader(line_reader_t *line_reader);
+
+/*
+ * gets the next line, reading as many times as it takes to complete it
+ * returns NULL at end of file or on a read error, otherwise the same as
+ * next_line()
+ */
+char *read_line(line_reader_t *line_reader, size_t *len);
+
+#endif  // LINEREADER_H_
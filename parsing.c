@@ -7,17 +7,423 @@
  */
 
 /* XXX: Preprocessor instruction to enable basic macros; do not modify. */
+#include <ctype.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "./arena.h"
+#include "./vars.h"
+
+// What a token is. TOKEN_QUOTED is a word with quoting somewhere in it, which
+// is never taken for an operator. Redirects other than &> and &>> can start
+// with the number of the fd they are for
+typedef enum {
+    TOKEN_WORD,
+    TOKEN_QUOTED,
+    TOKEN_IN,           // <
+    TOKEN_OUT,          // >
+    TOKEN_APPEND,       // >>
+    TOKEN_HEREDOC,      // <<
+    TOKEN_HERESTRING,   // <<<
+    TOKEN_BOTH,         // &>
+    TOKEN_BOTH_APPEND,  // &>>
+    TOKEN_DUP,          // >& and <&
+    TOKEN_PIPE,         // |
+    TOKEN_AMP,          // &
+    TOKEN_SEMI          // ;
+} token_type_t;
+
+// A token, as a slice of the command line it was lexed from. Once lex() is
+// done the text of a word is also '\0' terminated in place; operators are
+// known by their type alone. fd is the fd a redirect is for (&> is for 1 and
+// 2), and -1 for every other token
+typedef struct {
+    token_type_t type;
+    char *start;
+    size_t len;
+    int fd;
+} token_t;
+
+// One command of a pipeline, as filled in by parse(). tokens and argv end in
+// NULL and redirects in -1, and all of them are allocated from the arena of the
+// command line, sized to the command. fds has the fd of every token
+typedef struct {
+    char **tokens;
+    token_type_t *types;
+    int *fds;
+    char **argv;
+    int *redirects;
+    int argc;
+} stage_t;
+
+// What lex() leaves in a word in place of a '$' that expandWords() is to
+// expand: one outside quotes, whose value is split into words at blanks, or one
+// inside double quotes, whose value is not. A '$' that is quoted is left as it
+// is
+#define VAR_UNQUOTED '\x01'
+#define VAR_QUOTED '\x02'
+
+// text of each operator, indexed by its token type
+static char *operators[] = {NULL, NULL,  "<",  ">", ">>", "<<", "<<<",
+                            "&>", "&>>", ">&", "|", "&",  ";"};
+
+/*
+ * isRedirect()
+ *
+ * - Description: checks whether a token type is one of the redirects
+ *
+ * - Arguments: type: the token type
+ *
+ * - Returns: 1 for '<', '>', '>>', '<<', '<<<', '&>', '&>>', '>&' and '<&', 0
+ *   otherwise
+ */
+int isRedirect(token_type_t type) {
+    return type >= TOKEN_IN && type <= TOKEN_DUP;
+}
+
+/*
+ * isAssignment()
+ *
+ * - Description: checks whether a token is a variable assignment, a word of
+ *   the form NAME=value
+ *
+ * - Arguments: token: the token, once lex() is done with it
+ *
+ * - Returns: 1 if it is an assignment, 0 otherwise
+ */
+int isAssignment(const token_t *token) {
+    if (token->type != TOKEN_WORD && token->type != TOKEN_QUOTED) return 0;
+    const char *eq = strchr(token->start, '=');
+    return eq != NULL &&
+           valid_var_name(token->start, (size_t)(eq - token->start));
+}
+
+/*
+ * lex()
+ *
+ * - Description: splits the buffer into typed tokens in a single pass, without
+ *   copying it. Words are separated by whitespace and by the operators < > >>
+ *   << <<< &> &>> >& <& | & ;, which need no whitespace around them. A word of
+ *   digits right before < > >> << <<< >& or <& is the fd that redirect is for.
+ * Inside a word,
+ * '...' keeps everything up to the next ' as it is, "..." does the same except
+ * that \" \\ and \$ stand for " \ and $, and outside quotes \ keeps the next
+ * character as it is. Quotes and backslashes are removed by moving the rest of
+ * the word back over them, and each word is '\0' terminated in place. A '$'
+ * outside single quotes and not after a backslash is marked for expandWords()
+ * as VAR_UNQUOTED, or VAR_QUOTED inside double quotes
+ *
+ * - Arguments: buffer: a '\0' terminated char array representing user input,
+ *   tokens: set to the token array, allocated from arena (it starts out small
+ *   and is moved to twice the room whenever it fills up), arena: the arena of
+ *   the command line
+ *
+ * - Returns: the number of tokens, -1 if a quote is never closed, -2 if the
+ *   arena is out of memory
+ *
+ * - Usage:
+ *
+ *      /bin/echo "a b">out|wc -> [word /bin/echo, quoted a b, >, word out, |,
+ *                                 word wc]
+ *      ls 2>&1 -> [word ls, >& for fd 2, word 1]
+ */
+int lex(char *buffer, token_t **tokens, arena_t *arena) {
+    int n = 0;
+    int size = 0;
+    char *p = buffer;
+    *tokens = NULL;  // until the first token needs the array
+    while (1) {
+        while (*p == ' ' || *p == '\t' || *p == '\n') p++;
+        if (*p == '\0') break;
+        if (n == size) {
+            size = size ? size * 2 : 32;
+            token_t *t = arena_alloc(arena, sizeof(token_t) * (size_t)size);
+            if (t == NULL) return -2;
+            if (n > 0) memcpy(t, *tokens, sizeof(token_t) * (size_t)n);
+            *tokens = t;
+        }
+        token_t *t = &(*tokens)[n++];
+        t->start = p;
+        t->fd = -1;
+        char *op = p;  // past the fd number of a redirect
+        while (isdigit((unsigned char)*op)) op++;
+        if (op > p && (*op == '<' || *op == '>')) {
+            // too big to be any fd; caught along with the other bad ones
+            t->fd = op - p > 4 ? 10000 : atoi(p);
+        } else {
+            op = p;
+        }
+        switch (*op) {
+            case '<':
+                if (op[1] == '<') {
+                    t->type = op[2] == '<' ? TOKEN_HERESTRING : TOKEN_HEREDOC;
+                    p = op + (op[2] == '<' ? 3 : 2);
+                } else {
+                    t->type = op[1] == '&' ? TOKEN_DUP : TOKEN_IN;
+                    p = op + (op[1] == '&' ? 2 : 1);
+                }
+                if (t->fd == -1) t->fd = 0;
+                t->len = (size_t)(p - t->start);
+                continue;
+            case '>':
+                t->type = op[1] == '>' ? TOKEN_APPEND
+                                       : op[1] == '&' ? TOKEN_DUP : TOKEN_OUT;
+                if (t->fd == -1) t->fd = 1;
+                p = op + (t->type == TOKEN_OUT ? 1 : 2);
+                t->len = (size_t)(p - t->start);
+                continue;
+            case '|':
+                t->type = TOKEN_PIPE;
+                t->len = 1;
+                p++;
+                continue;
+            case '&':
+                if (p[1] == '>') {
+                    t->type = p[2] == '>' ? TOKEN_BOTH_APPEND : TOKEN_BOTH;
+                    t->fd = 1;
+                    t->len = p[2] == '>' ? 3 : 2;
+                } else {
+                    t->type = TOKEN_AMP;
+                    t->len = 1;
+                }
+                p += t->len;
+                continue;
+            case ';':
+                t->type = TOKEN_SEMI;
+                t->len = 1;
+                p++;
+                continue;
+        }
+        t->type = TOKEN_WORD;
+        char *out = p;  // where the next character of the word goes
+        while (*p != '\0' && strchr(" \t\n<>|&;", *p) == NULL) {
+            if (*p == '\'' || *p == '"') {
+                char quote = *p++;
+                t->type = TOKEN_QUOTED;
+                while (*p != quote) {
+                    if (*p == '\0') return -1;
+                    if (quote == '"' && *p == '\\' &&
+                        (p[1] == '"' || p[1] == '\\' || p[1] == '$'))
+                        p++;
+                    else if (quote == '"' && *p == '$')
+                        *p = VAR_QUOTED;
+                    *out++ = *p++;
+                }
+                p++;
+            } else if (*p == '\\' && p[1] != '\0') {
+                t->type = TOKEN_QUOTED;
+                p++;
+                *out++ = *p++;
+            } else if (*p == '$') {
+                *out++ = VAR_UNQUOTED;
+                p++;
+            } else {
+                *out++ = *p++;
+            }
+        }
+        t->len = (size_t)(out - t->start);
+    }
+    // only now that every operator has been read can the character after a
+    // word be overwritten, since it may be the operator that ended it
+    for (int i = 0; i < n; i++) {
+        token_t *t = &(*tokens)[i];
+        if (t->type == TOKEN_WORD || t->type == TOKEN_QUOTED)
+            t->start[t->len] = '\0';
+    }
+    return n;
+}
+
+// Works out which variable the marked '$' at p expands: the name after it, or
+// the one in the {} after it. Sets *name to it and *skip to how many
+// characters the reference takes. Returns the length of the name, 0 if there
+// is none (the '$' then stands for itself)
+static size_t varName(const char *p, const char **name, size_t *skip) {
+    size_t len = 0;
+    *name = p + 1;
+    if (**name == '{') {
+        const char *close = strchr(++*name, '}');
+        if (close == NULL || !valid_var_name(*name, (size_t)(close - *name)))
+            return 0;
+        len = (size_t)(close - *name);
+        *skip = len + 3;
+        return len;
+    }
+    while (valid_var_name(*name, len + 1)) len++;
+    *skip = len + 1;
+    return len;
+}
+
+// Adds c to the expansion being written to out (if it is not NULL), which is
+// n characters long, first ending the word being written (field characters
+// long) if a blank is pending
+static void putExpanded(char *out, size_t *n, size_t *field, int *pending,
+                        char c) {
+    if (*pending) {
+        if (out) out[*n] = '\0';
+        (*n)++;
+        *field = 0;
+        *pending = 0;
+    }
+    if (out) out[*n] = c;
+    (*n)++;
+    (*field)++;
+}
+
+// Does the work of expandWord() and expandWords(): writes the expansion of word
+// to out if it is not NULL, with $? as status. If split is set, the blanks in
+// the value of a variable outside double quotes end a word, and the words are
+// written separated by '\0's. Returns the length of the expansion
+static size_t expandInto(const char *word, var_store_t *vars, int status,
+                         int split, char *out) {
+    size_t n = 0, field = 0;
+    int pending = 0;  // whether a blank is waiting to end a word
+    for (const char *p = word; *p;) {
+        int marked = *p == VAR_UNQUOTED || *p == VAR_QUOTED;
+        const char *name, *value = NULL;
+        char number[12];
+        size_t skip, len = 0;
+        if (marked && p[1] == '?') {
+            snprintf(number, sizeof(number), "%d", status);
+            value = number;
+            len = 1;
+            skip = 2;
+        } else if (marked && (len = varName(p, &name, &skip)) > 0) {
+            value = get_var(vars, name, len);
+        }
+        if (len == 0) {  // not a variable, so just a character
+            putExpanded(out, &n, &field, &pending, marked ? '$' : *p);
+            p++;
+            continue;
+        }
+        for (; value != NULL && *value; value++) {
+            if (split && *p == VAR_UNQUOTED && strchr(" \t\n", *value))
+                pending = field > 0;
+            else
+                putExpanded(out, &n, &field, &pending, *value);
+        }
+        p += skip;
+    }
+    return n;
+}
+
+/*
+ * expandWord()
+ *
+ * - Description: expands the variables lex() marked in a word: each $NAME or
+ *   ${NAME} is replaced by the value of the variable NAME, or by nothing if it
+ *   is not set, and $? by status. The word is not split
+ *
+ * - Arguments: word: the '\0' terminated word, vars: the variables, status:
+ *   the status of the last job, arena: the arena of the command line, which
+ *   the expansion is allocated from
+ *
+ * - Returns: the expanded word, word itself if nothing in it is to be
+ *   expanded, or NULL if the arena is out of memory
+ */
+char *expandWord(char *word, var_store_t *vars, int status, arena_t *arena) {
+    if (strpbrk(word, "\x01\x02") == NULL) return word;
+    size_t len = expandInto(word, vars, status, 0, NULL);
+    char *expanded = arena_alloc(arena, len + 1);
+    if (expanded == NULL) return NULL;
+    expandInto(word, vars, status, 0, expanded);
+    expanded[len] = '\0';
+    return expanded;
+}
+
+/*
+ * expandWords()
+ *
+ * - Description: expands the variables in the words of one command,
+ *   tokens[start, *end), as expandWord() does, just before it runs, so that it
+ *   sees what the commands before it set. Outside double quotes, the blanks in
+ *   a value split the word it is in into words, except in an assignment or
+ *   the word after a redirect. A word with no quoting that comes out empty is
+ *   dropped
+ *
+ * - Arguments: tokens: the token array, replaced with one allocated from arena
+ *   if words are added or dropped, ntokens: the number of tokens, start, end:
+ *   the command, whose end is moved to match, vars: the variables, status: the
+ *   status of the last job, arena: the arena of the command line
+ *
+ * - Returns: the new number of tokens, -2 if the arena is out of memory
+ *
+ * - Usage:
+ *
+ *      echo $X "$X" y (X is "a b") -> [word echo, word a, word b, quoted a b,
+ *                                      word y]
+ */
+int expandWords(token_t **tokens, int ntokens, int start, int *end,
+                var_store_t *vars, int status, arena_t *arena) {
+    int i = start;
+    while (i < *end && !(((*tokens)[i].type == TOKEN_WORD ||
+                          (*tokens)[i].type == TOKEN_QUOTED) &&
+                         strpbrk((*tokens)[i].start, "\x01\x02") != NULL))
+        i++;
+    if (i == *end) return ntokens;  // nothing to expand
+    int n = *end - start;
+    char **words = arena_alloc(arena, sizeof(char *) * (size_t)n);
+    size_t *lens = arena_alloc(arena, sizeof(size_t) * (size_t)n);
+    int *nwords = arena_alloc(arena, sizeof(int) * (size_t)n);
+    if (words == NULL || lens == NULL || nwords == NULL) return -2;
+    int total = ntokens - n;
+    for (i = 0; i < n; i++) {
+        token_t *t = &(*tokens)[start + i];
+        nwords[i] = 1;
+        if ((t->type != TOKEN_WORD && t->type != TOKEN_QUOTED) ||
+            strpbrk(t->start, "\x01\x02") == NULL) {
+            total++;
+            continue;
+        }
+        int split = !isAssignment(t) &&
+                    !(i > 0 && isRedirect((*tokens)[start + i - 1].type));
+        lens[i] = expandInto(t->start, vars, status, split, NULL);
+        if ((words[i] = arena_alloc(arena, lens[i] + 1)) == NULL) return -2;
+        expandInto(t->start, vars, status, split, words[i]);
+        words[i][lens[i]] = '\0';
+        for (size_t j = 0; j < lens[i]; j++) nwords[i] += words[i][j] == '\0';
+        if (lens[i] == 0 && t->type == TOKEN_WORD) nwords[i] = 0;
+        total += nwords[i];
+    }
+    token_t *expanded = arena_alloc(arena, sizeof(token_t) * (size_t)total);
+    if (expanded == NULL) return -2;
+    memcpy(expanded, *tokens, sizeof(token_t) * (size_t)start);
+    int m = start;
+    for (i = 0; i < n; i++) {
+        token_t *t = &(*tokens)[start + i];
+        if ((t->type != TOKEN_WORD && t->type != TOKEN_QUOTED) ||
+            strpbrk(t->start, "\x01\x02") == NULL) {
+            expanded[m++] = *t;
+            continue;
+        }
+        char *w = words[i];
+        for (int j = 0; j < nwords[i]; j++, m++) {
+            expanded[m] = *t;
+            expanded[m].start = w;
+            expanded[m].len = strlen(w);
+            w += expanded[m].len + 1;
+        }
+    }
+    memcpy(expanded + m, *tokens + *end,
+           sizeof(token_t) * (size_t)(ntokens - *end));
+    *end = m;
+    *tokens = expanded;
+    return total;
+}
 
 /*
  * parse()
  *
- * - Description: creates the token and argv arrays from the buffer character
- *   array
+ * - Description: creates the token and argv arrays of a single command from
+ *   its tokens, which must not include '|', '&' or ';'
  *
- * - Arguments: buffer: a char array representing user input, tokens: the
- * tokenized input, argv: the argument array eventually used for execv()
+ * - Arguments: tokens: the command's tokens as lexed by lex(), n: how many
+ *   there are, stage: filled in with the command's tokens (operators as their
+ *   text), their types and fds, argv (every word that is not the file of a
+ * redirect) and the index of each redirect, ending in -1, arena: the arena of
+ * the command line, which the arrays of stage are allocated from
+ *
+ * - Returns: 0 on success, -1 if the arena is out of memory
  *
  * - Usage:
  *
@@ -25,48 +431,124 @@
  *
  *      cd dir -> [cd, dir]
  *      [tab]mkdir[tab][space]name -> [mkdir, name]
- *      /bin/echo 'Hello world!' -> [/bin/echo, 'Hello, world!']
+ *      /bin/echo 'Hello world!' -> [/bin/echo, Hello world!]
  *
  *      For the argv array:
  *
- *       char *argv[4];
+ *       char *argv[3];
  *       argv[0] = echo;
- *       argv[1] = 'Hello;
- *       argv[2] = world!';
- *       argv[3] = NULL;
- *
- * - Hint: for this part of the assignment, you are allowed to use the built
- *   in string functions listed in the handout
+ *       argv[1] = Hello world!;
+ *       argv[2] = NULL;
  */
-void parse(char buffer[1024], char *tokens[512], char *argv[512],
-           int redirects[512]) {
-    char *token;
-    char *str = buffer;
-    char *str1 = strrchr(buffer, '/');
-    int i;       // tokens index
-    int j = 0;   // argv array index
-    int k = 0;   // redirect array index
-    int r = -2;  // redirection char index set to -2 to avoid false positives as
-    // we check if i-1=r, where i starts at 0
-    for (i = 0; (token = strtok(str, " \t\n")) != NULL; i++) {
-        tokens[i] = token;
-        str = NULL;
-        if (strcmp(tokens[i], ">") != 0 && strcmp(tokens[i], ">>") != 0 &&
-            strcmp(tokens[i], "<") != 0 && i - 1 != r) {
-            argv[j] = tokens[i];  // ignore all redirect chars and their
-            // succeeding files when adding to argv
-            j++;
-        } else if (strcmp(tokens[i], ">") == 0 ||
-                   strcmp(tokens[i], ">>") == 0 ||
-                   strcmp(tokens[i], "<") == 0) {
-            r = i;
-            redirects[k] = r;  // save redirect char index
-            k++;
+int parse(token_t *tokens, int n, stage_t *stage, arena_t *arena) {
+    int j = 0;  // argv array index
+    int k = 0;  // redirect array index
+    size_t room = (size_t)n + 1;
+    stage->tokens = arena_alloc(arena, sizeof(char *) * room);
+    stage->types = arena_alloc(arena, sizeof(token_type_t) * room);
+    stage->fds = arena_alloc(arena, sizeof(int) * room);
+    stage->argv = arena_alloc(arena, sizeof(char *) * room);
+    stage->redirects = arena_alloc(arena, sizeof(int) * room);
+    if (stage->tokens == NULL || stage->types == NULL || stage->fds == NULL ||
+        stage->argv == NULL || stage->redirects == NULL)
+        return -1;
+    for (int i = 0; i < n; i++) {
+        stage->types[i] = tokens[i].type;
+        stage->fds[i] = tokens[i].fd;
+        if (isRedirect(tokens[i].type)) {
+            stage->tokens[i] = operators[tokens[i].type];
+            stage->redirects[k++] = i;  // save redirect char index
+        } else {
+            stage->tokens[i] = tokens[i].start;
+            // ignore the files of redirects when adding to argv
+            if (i == 0 || !isRedirect(tokens[i - 1].type))
+                stage->argv[j++] = stage->tokens[i];
         }
     }
-    if (str1 != NULL) {
-        str1 = &str1[1];
-        if ((argv[0] = strtok(str1, " \t\n")) == NULL) argv[0] = "";
+    stage->tokens[n] = NULL;
+    stage->argv[j] = NULL;
+    stage->redirects[k] = -1;
+    stage->argc = j;
+    char *name;
+    if (j > 0 && (name = strrchr(stage->argv[0], '/')) != NULL) {
+        stage->argv[0] = name + 1;  // argv[0] is just the name of the command
     }
-    argv[j] = NULL;
+    return 0;
+}
+
+/*
+ * parsePipeline()
+ *
+ * - Description: splits the tokens of a command at every '|' and parses each
+ *   stage of the pipeline on its own
+ *
+ * - Arguments: tokens: the command's tokens as lexed by lex(), which must not
+ *   include '&' or ';', n: how many there are, stages: set to the stage array,
+ *   allocated from arena, arena: the arena of the command line
+ *
+ * - Returns: the number of stages, 0 if there are no tokens, -1 if a stage of
+ *   a pipeline is empty, -2 if the arena is out of memory
+ *
+ * - Usage:
+ *
+ *      /bin/cat file | /bin/wc -l -> [/bin/cat file, /bin/wc -l]
+ */
+int parsePipeline(token_t *tokens, int n, stage_t **stages, arena_t *arena) {
+    int nstages = 1;
+    int start = 0;
+    if (n == 0) return 0;
+    for (int i = 0; i < n; i++)
+        if (tokens[i].type == TOKEN_PIPE) nstages++;
+    if ((*stages = arena_alloc(arena, sizeof(stage_t) * (size_t)nstages)) ==
+        NULL)
+        return -2;
+    nstages = 0;
+    while (1) {
+        int end = start;
+        while (end < n && tokens[end].type != TOKEN_PIPE) end++;
+        if (end == start) return -1;
+        if (parse(tokens + start, end - start, &(*stages)[nstages++], arena) ==
+            -1)
+            return -2;
+        if (end == n) return nstages;
+        start = end + 1;
+    }
+}
+
+/*
+ * commandEnd()
+ *
+ * - Description: finds the end of the command starting at start, which is
+ *   the next '&' or ';', or the end of the line
+ *
+ * - Arguments: tokens: the line's tokens as lexed by lex(), n: how many there
+ *   are, start: index of the command's first token
+ *
+ * - Returns: the index of the token ending the command, n if there is none
+ */
+int commandEnd(const token_t *tokens, int n, int start) {
+    while (start < n && tokens[start].type != TOKEN_AMP &&
+           tokens[start].type != TOKEN_SEMI)
+        start++;
+    return start;
+}
+
+/*
+ * commandIndex()
+ *
+ * - Description: finds the command in a parsed stage, skipping any redirects
+ *   (and their files) that come before it
+ *
+ * - Arguments: redirects: the redirect char indexes filled in by parse()
+ *
+ * - Returns: the index of the command in tokens
+ *
+ * - Usage:
+ *
+ *      < in /bin/cat > out -> 2
+ */
+int commandIndex(const int *redirects) {
+    int i = 0;
+    for (int j = 0; redirects[j] == i; j++) i += 2;
+    return i;
 }
@@ -0,0 +1,305 @@
+#include "./pathcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// PATH to search when the environment does not have one
+#define DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+
+// a cached lookup; path is NULL if name was not found anywhere on PATH
+// dir is the last PATH directory the result depends on: the one name was
+// found in, or the last one if it was not found
+struct path_entry {
+    char *name;
+    char *path;
+    int dir;
+};
+typedef struct path_entry path_entry_t;
+
+// a PATH directory and its mtime when the cache was last checked against it
+struct path_dir {
+    char *dir;
+    struct timespec mtime;
+    int exists;
+};
+typedef struct path_dir path_dir_t;
+
+// path_var is a copy of the PATH the cache was filled under
+// entries is an open addressing hash table of size entries_size (a power of
+// two), with count entries in use
+// scratch holds the candidate paths built while searching the directories
+// the directories were last checked in generation checked, and are checked
+// again by the first lookup once generation has moved on
+struct path_cache {
+    unsigned long generation;
+    unsigned long checked;
+    char *path_var;
+    path_dir_t *dirs;
+    int ndirs;
+    path_entry_t *entries;
+    size_t entries_size;
+    size_t count;
+    char *scratch;
+    size_t scratch_size;
+};
+
+/* FNV-1a hash of a command name */
+static size_t hash_name(const char *name) {
+    size_t h = 14695981039346656037UL;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/* finds the slot for name, which is either its entry or an empty slot */
+static path_entry_t *find_slot(path_entry_t *entries, size_t size,
+                               const char *name) {
+    size_t i = hash_name(name) & (size - 1);
+    while (entries[i].name != NULL && strcmp(entries[i].name, name) != 0) {
+        i = (i + 1) & (size - 1);
+    }
+    return &entries[i];
+}
+
+/* initializes path cache, returns pointer */
+path_cache_t *init_path_cache() {
+    path_cache_t *path_cache = (path_cache_t *)malloc(sizeof(path_cache_t));
+    path_cache->generation = 0;
+    path_cache->checked = 0;
+    path_cache->path_var = NULL;
+    path_cache->dirs = NULL;
+    path_cache->ndirs = 0;
+    path_cache->entries_size = 64;
+    path_cache->entries =
+        (path_entry_t *)calloc(path_cache->entries_size, sizeof(path_entry_t));
+    path_cache->count = 0;
+    path_cache->scratch = NULL;
+    path_cache->scratch_size = 0;
+    return path_cache;
+}
+
+/* forgets every cached lookup */
+void clear_path_cache(path_cache_t *path_cache) {
+    if (path_cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < path_cache->entries_size; i++) {
+        free(path_cache->entries[i].name);
+        free(path_cache->entries[i].path);
+    }
+    memset(path_cache->entries, 0,
+           sizeof(path_entry_t) * path_cache->entries_size);
+    path_cache->count = 0;
+    path_cache->generation++;
+}
+
+/*
+ * starts a new generation, e.g. for a new command line: the next lookup checks
+ * the PATH directories again, and the ones after it until the next generation
+ * trust what is cached
+ */
+void next_path_generation(path_cache_t *path_cache) {
+    if (path_cache != NULL) path_cache->generation++;
+}
+
+/* forgets the PATH the cache was filled under, and its directories */
+static void free_dirs(path_cache_t *path_cache) {
+    for (int i = 0; i < path_cache->ndirs; i++) {
+        free(path_cache->dirs[i].dir);
+    }
+    free(path_cache->dirs);
+    free(path_cache->path_var);
+    path_cache->dirs = NULL;
+    path_cache->ndirs = 0;
+    path_cache->path_var = NULL;
+}
+
+/*
+ * cleans up path cache
+ * Note: this function will free the path_cache pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_path_cache(path_cache_t *path_cache) {
+    if (path_cache == NULL) {
+        return;
+    }
+
+    clear_path_cache(path_cache);
+    free_dirs(path_cache);
+    free(path_cache->entries);
+    free(path_cache->scratch);
+    free(path_cache);
+}
+
+/*
+ * stats every PATH directory, returns the first one that has appeared,
+ * disappeared or had its mtime change since the last check, -1 if none has
+ */
+static int dirs_changed(path_cache_t *path_cache) {
+    int changed = -1;
+    for (int i = 0; i < path_cache->ndirs; i++) {
+        path_dir_t *d = &path_cache->dirs[i];
+        struct stat st;
+        int exists = stat(d->dir, &st) == 0;
+        if (exists != d->exists ||
+            (exists && (st.st_mtim.tv_sec != d->mtime.tv_sec ||
+                        st.st_mtim.tv_nsec != d->mtime.tv_nsec))) {
+            if (changed == -1) changed = i;
+        }
+        d->exists = exists;
+        if (exists) d->mtime = st.st_mtim;
+    }
+    return changed;
+}
+
+/* splits a new PATH into its directories, an empty one meaning "." */
+static void load_dirs(path_cache_t *path_cache, const char *path_var) {
+    free_dirs(path_cache);
+    path_cache->path_var = strdup(path_var);
+
+    int n = 1;
+    for (const char *c = path_var; *c; c++) {
+        if (*c == ':') n++;
+    }
+    path_cache->dirs = (path_dir_t *)calloc((size_t)n, sizeof(path_dir_t));
+    path_cache->ndirs = n;
+
+    const char *start = path_var;
+    for (int i = 0; i < n; i++) {
+        const char *end = strchr(start, ':');
+        size_t len = end == NULL ? strlen(start) : (size_t)(end - start);
+        path_cache->dirs[i].dir = len == 0 ? strdup(".") : strndup(start, len);
+        start = end == NULL ? start : end + 1;
+    }
+    dirs_changed(path_cache);
+    path_cache->checked = path_cache->generation;
+}
+
+/* forgets the cached lookups that depend on PATH directory first or a later
+ * one, keeping the others */
+static void forget_entries(path_cache_t *path_cache, int first) {
+    path_entry_t *entries =
+        (path_entry_t *)calloc(path_cache->entries_size, sizeof(path_entry_t));
+    path_cache->count = 0;
+    for (size_t i = 0; i < path_cache->entries_size; i++) {
+        path_entry_t *e = &path_cache->entries[i];
+        if (e->name == NULL) continue;
+        if (e->dir >= first) {
+            free(e->name);
+            free(e->path);
+            continue;
+        }
+        *find_slot(entries, path_cache->entries_size, e->name) = *e;
+        path_cache->count++;
+    }
+    free(path_cache->entries);
+    path_cache->entries = entries;
+}
+
+/* caches the result of looking up name, doubling the table when it is 3/4 full,
+ * returns the cached path */
+static const char *insert_entry(path_cache_t *path_cache, const char *name,
+                                const char *path, int dir) {
+    if ((path_cache->count + 1) * 4 > path_cache->entries_size * 3) {
+        size_t size = path_cache->entries_size * 2;
+        path_entry_t *entries =
+            (path_entry_t *)calloc(size, sizeof(path_entry_t));
+        for (size_t i = 0; i < path_cache->entries_size; i++) {
+            if (path_cache->entries[i].name != NULL) {
+                *find_slot(entries, size, path_cache->entries[i].name) =
+                    path_cache->entries[i];
+            }
+        }
+        free(path_cache->entries);
+        path_cache->entries = entries;
+        path_cache->entries_size = size;
+    }
+    path_entry_t *e =
+        find_slot(path_cache->entries, path_cache->entries_size, name);
+    e->name = strdup(name);
+    e->path = path == NULL ? NULL : strdup(path);
+    e->dir = dir;
+    path_cache->count++;
+    return e->path;
+}
+
+/*
+ * resolves a command name to an executable in one of the PATH directories,
+ * returns the full path on success, NULL if there is no such executable
+ * names containing a '/' are returned as they are
+ * both results are cached until PATH or one of its directories changes, so
+ * repeated lookups of the same name do not search the directories again; the
+ * directories are only checked for changes by the first lookup of each
+ * generation (see next_path_generation()), so a cached lookup touches no
+ * directory at all
+ * the returned path is only valid until the next call
+ */
+const char *path_lookup(path_cache_t *path_cache, const char *name) {
+    if (path_cache == NULL || strchr(name, '/') != NULL) {
+        return name;
+    }
+
+    const char *path_var = getenv("PATH");
+    if (path_var == NULL) path_var = DEFAULT_PATH;
+    if (path_cache->path_var == NULL ||
+        strcmp(path_var, path_cache->path_var) != 0) {
+        clear_path_cache(path_cache);
+        load_dirs(path_cache, path_var);
+    }
+
+    // the directories are checked once a generation, and a change only
+    // affects the lookups that depend on that directory or a later one
+    if (path_cache->checked != path_cache->generation) {
+        int changed = dirs_changed(path_cache);
+        if (changed != -1) forget_entries(path_cache, changed);
+        path_cache->checked = path_cache->generation;
+    }
+    path_entry_t *e =
+        find_slot(path_cache->entries, path_cache->entries_size, name);
+    if (e->name != NULL) {
+        return e->path;
+    }
+
+    size_t namelen = strlen(name);
+    for (int i = 0; i < path_cache->ndirs; i++) {
+        const char *dir = path_cache->dirs[i].dir;
+        size_t dirlen = strlen(dir);
+        if (dirlen + namelen + 2 > path_cache->scratch_size) {
+            path_cache->scratch_size = dirlen + namelen + 2;
+            path_cache->scratch =
+                (char *)realloc(path_cache->scratch, path_cache->scratch_size);
+        }
+        memcpy(path_cache->scratch, dir, dirlen);
+        path_cache->scratch[dirlen] = '/';
+        memcpy(path_cache->scratch + dirlen + 1, name, namelen + 1);
+
+        struct stat st;
+        if (stat(path_cache->scratch, &st) == 0 && S_ISREG(st.st_mode) &&
+            access(path_cache->scratch, X_OK) == 0) {
+            return insert_entry(path_cache, name, path_cache->scratch, i);
+        }
+    }
+    return insert_entry(path_cache, name, NULL, path_cache->ndirs - 1);
+}
+
+/* hash command, prints every cached command with its path */
+void print_path_cache(path_cache_t *path_cache) {
+    if (path_cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < path_cache->entries_size; i++) {
+        path_entry_t *e = &path_cache->entries[i];
+        if (e->name != NULL && e->path != NULL) {
+            if (printf("%s\t%s\n", e->name, e->path) < 0) {
+                fprintf(stderr, "error printing hash table\n");
+                return;
+            }
+        }
+    }
+}
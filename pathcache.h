@@ -0,0 +1,41 @@
+#ifndef PATHCACHE_H_
+#define PATHCACHE_H_
+
+typedef struct path_cache path_cache_t;
+
+/* initializes path cache, returns pointer */
+path_cache_t *init_path_cache();
+/*
+ * cleans up path cache
+ * Note: this function will free the path_cache pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_path_cache(path_cache_t *path_cache);
+
+/*
+ * resolves a command name to an executable in one of the PATH directories,
+ * returns the full path on success, NULL if there is no such executable
+ * names containing a '/' are returned as they are
+ * both results are cached until PATH or one of its directories changes, so
+ * repeated lookups of the same name do not search the directories again; the
+ * directories are only checked for changes by the first lookup of each
+ * generation (see next_path_generation()), so a cached lookup touches no
+ * directory at all
+ * the returned path is only valid until the next call
+ */
+const char *path_lookup(path_cache_t *path_cache, const char *name);
+
+/* forgets every cached lookup */
+void clear_path_cache(path_cache_t *path_cache);
+
+/*
+ * starts a new generation, e.g. for a new command line: the next lookup checks
+ * the PATH directories again, and the ones after it until the next generation
+ * trust what is cached
+ */
+void next_path_generation(path_cache_t *path_cache);
+
+/* hash command, prints every cached command with its path */
+void print_path_cache(path_cache_t *path_cache);
+
+#endif  // PATHCACHE_H_
@@ -0,0 +1,189 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "./arena.h"
+#include "./events.h"
+#include "./history.h"
+#include "./jobs.h"
+#include "./linereader.h"
+
+// Prints prompt, unless this is 33noprompt or we are running a script, and
+// flushes stdout so that it and any job reports show up right away
+void printPrompt(int script, const char *prompt, job_list_t *job_list) {
+#ifdef PROMPT
+    if (!script && printf("%s", prompt) < 0) {
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+#else
+    (void)script;
+    (void)prompt;
+#endif
+    if (fflush(stdout) < 0) {
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+}
+
+// Gets the next line of input, waiting on events for it. If notify is set
+// (33sh -b), children are also reaped and reported as soon as they change
+// state while waiting, followed by prompt again; otherwise that waits for the
+// next command prompt, as it always has. events is NULL for a script, which
+// has no input to wait for. Returns NULL at end of input, otherwise the same as
+// next_line()
+static char *readLine(line_reader_t *reader, event_loop_t *events, int notify,
+                      const char *prompt, job_list_t *job_list, size_t *len) {
+    char *line;
+    if (events == NULL) return read_line(reader, len);
+    while ((line = next_line(reader, len)) == NULL) {
+        switch (wait_event(events)) {
+            case EVENT_CHILD:
+                if (notify && childReaper(job_list, stdout) > 0)
+                    printPrompt(0, prompt, job_list);
+                break;
+            case EVENT_INPUT: {
+                ssize_t n = fill_line_reader(reader);
+                if (n < 0) return NULL;
+                // end of input, though there may be a last line with no '\n'
+                if (n == 0) return next_line(reader, len);
+                break;
+            }
+            case EVENT_ERROR:
+                return read_line(reader, len);
+        }
+    }
+    return line;
+}
+
+// Reaps any finished children, prompts, and gets the next command line, as
+// readLine() does. Returns NULL at end of input, otherwise the same as
+// next_line()
+char *readCommand(line_reader_t *reader, event_loop_t *events, int notify,
+                  job_list_t *job_list, size_t *len) {
+    childReaper(job_list, stdout);
+    printPrompt(events == NULL, "33sh> ", job_list);
+    return readLine(reader, events, notify, "33sh> ", job_list, len);
+}
+
+// Opens the history: the file HISTFILE names, or ~/.33sh_history. Only
+// commands typed at a terminal are kept, unless HISTFILE is set, and never
+// those of a script. Returns the history, NULL if there is none (having
+// printed why if it could not be opened)
+history_t *openHistory(int script) {
+    const char *path = getenv("HISTFILE"), *home = getenv("HOME");
+    char buf[PATH_MAX];
+    history_t *history;
+    if (script || (path == NULL && !isatty(STDIN_FILENO))) return NULL;
+    if (path == NULL) {
+        if (home == NULL) return NULL;
+        if (snprintf(buf, sizeof(buf), "%s/.33sh_history", home) >=
+            (int)sizeof(buf))
+            return NULL;
+        path = buf;
+    }
+    if ((history = init_history(path)) == NULL) perror(path);
+    return history;
+}
+
+// Recalls a line from the history for a command line starting with '!': !! is
+// the last line, and !prefix the most recent one starting with prefix, which
+// runs up to the first blank; the rest of the command line is kept after it.
+// The line is printed, as it is about to be run, and put together in arena.
+// Returns the line to run (line itself if it does not start with '!'), with
+// its length in *len, or NULL (having printed why) if no line matches
+char *recallHistory(history_t *history, char *line, size_t *len, arena_t *arena,
+                    job_list_t *job_list) {
+    if (line[0] != '!' || line[1] == '\0' || line[1] == ' ' || line[1] == '\t')
+        return line;
+    size_t prefix = line[1] == '!' ? 1 : strcspn(line + 1, " \t");
+    size_t found_len, rest = *len - 1 - prefix;
+    const char *found = find_history(history, line + 1,
+                                     line[1] == '!' ? 0 : prefix, &found_len);
+    if (found == NULL) {
+        if (fprintf(stderr, "%.*s: event not found\n", (int)prefix + 1, line) <
+            0) {
+            perror("Error printing event not found error");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        return NULL;
+    }
+    char *recalled = arena_alloc(arena, found_len + rest + 1);
+    if (recalled == NULL) {
+        perror("Error recalling history");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    memcpy(recalled, found, found_len);
+    memcpy(recalled + found_len, line + 1 + prefix, rest + 1);
+    *len = found_len + rest;
+    if (printf("%s\n", recalled) < 0) {
+        perror("Error printing recalled line");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    return recalled;
+}
+
+// Reads the body of every '<<' among the n tokens of a command line, from the
+// lines that follow it, in the order they appear. Each body runs up to a line
+// that is just its delimiter (or the end of input) and is copied into arena,
+// then replaces the delimiter as the token after the '<<'; a '<<<' word just
+// gets a '\n' added. The line itself must not be in the reader's buffer, which
+// reading more lines moves. Returns 0, -1 if arena is out of memory
+int readHereDocs(token_t *tokens, int n, line_reader_t *reader,
+                 event_loop_t *events, int notify, job_list_t *job_list,
+                 arena_t *arena) {
+    for (int i = 0; i + 1 < n; i++) {
+        token_t *t = &tokens[i + 1];
+        if ((tokens[i].type != TOKEN_HEREDOC &&
+             tokens[i].type != TOKEN_HERESTRING) ||
+            (t->type != TOKEN_WORD && t->type != TOKEN_QUOTED))
+            continue;
+        size_t size = t->len + 2;  // room for a '\n' and the '\0'
+        size_t used = 0;
+        char *body = arena_alloc(arena, size);
+        if (body == NULL) return -1;
+        if (tokens[i].type == TOKEN_HERESTRING) {
+            memcpy(body, t->start, t->len);
+            used = t->len;
+            body[used++] = '\n';
+        } else {
+            char *line;
+            size_t len;
+            while (1) {
+                printPrompt(events == NULL, "> ", job_list);
+                if ((line = readLine(reader, events, notify, "> ", job_list,
+                                     &len)) == NULL) {
+                    if (fprintf(stderr,
+                                "warning: here-document delimited by "
+                                "end-of-file (wanted `%s')\n",
+                                t->start) < 0) {
+                        perror("Error printing here-document warning");
+                        cleanup_job_list(job_list);
+                        exit(1);
+                    }
+                    break;
+                }
+                if (strcmp(line, t->start) == 0) break;
+                // the body grows by doubling, as the token array does
+                if (used + len + 2 > size) {
+                    while (used + len + 2 > size) size *= 2;
+                    char *grown = arena_alloc(arena, size);
+                    if (grown == NULL) return -1;
+                    memcpy(grown, body, used);
+                    body = grown;
+                }
+                memcpy(body + used, line, len);
+                used += len;
+                body[used++] = '\n';
+            }
+        }
+        body[used] = '\0';
+        t->start = body;
+        t->len = used;
+    }
+    return 0;
+}
@@ -3,18 +3,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-// The function checks for any syntax error in our redirects, and if we have any
-// we will return -1, otherwise we return 0
-int redirectsErrorChecker(char *tokens[512], const int redirects[512],
-                          char *argv[512], job_list_t *job_list) {
+// The function checks for any syntax error in the redirects of a stage, and if
+// we have any we will return -1, otherwise we return 0. Only one redirect can
+// be for stdin and one for stdout; 2> and n>&m can be used as often as needed,
+// as long as every fd is between 0 and SPAWN_MAX_FD
+int redirectsErrorChecker(stage_t *stage, job_list_t *job_list) {
+    const int *redirects = stage->redirects;
     int i = 0;
     int oc = 0;  // output redirect counter
     int ic = 0;  // input redirect counter
     for (; redirects[i] != -1; i++) {
-        if (strcmp(tokens[redirects[i]], ">") == 0 ||
-            strcmp(tokens[redirects[i]], ">>") == 0)
-            oc++;
-        if (strcmp(tokens[redirects[i]], "<") == 0) ic++;
+        int fd = stage->fds[redirects[i]];
+        const char *file = stage->tokens[redirects[i] + 1];
+        if (fd == STDIN_FILENO) ic++;
+        if (fd == STDOUT_FILENO) oc++;
         if (oc > 1 || ic > 1) {
             if (fprintf(stderr,
                         "syntax error: too many output/input redirects\n") <
@@ -27,15 +29,27 @@ int redirectsErrorChecker(char *tokens[512], const int redirects[512],
             }
             return -1;
         }
-        if (tokens[redirects[i] + 1] == NULL) {
+        // the file must be a word, not the end of the line or another redirect
+        if (stage->tokens[redirects[i] + 1] == NULL ||
+            isRedirect(stage->types[redirects[i] + 1])) {
             if (fprintf(stderr, "syntax error: no input/output file\n") < 0) {
                 perror("Error printing no input/output file error");
                 cleanup_job_list(job_list);
                 exit(1);
             }
             return -1;
+        } else if (fd > SPAWN_MAX_FD ||
+                   (stage->types[redirects[i]] == TOKEN_DUP &&
+                    (strlen(file) != 1 || file[0] < '0' ||
+                     file[0] > '0' + SPAWN_MAX_FD))) {
+            if (fprintf(stderr, "syntax error: bad file descriptor\n") < 0) {
+                perror("Error printing bad file descriptor error");
+                cleanup_job_list(job_list);
+                exit(1);
+            }
+            return -1;
         } else {
-            if (argv[0] == NULL) {
+            if (stage->argv[0] == NULL) {
                 if (fprintf(stderr,
                             "syntax error: redirects with no command\n") < 0) {
                     perror(
@@ -0,0 +1,101 @@
+#include "./rlimits.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// what each ulimit option limits, what it is called, and how many bytes its
+// unit is (1 for a count)
+static const struct {
+    char option;
+    int resource;
+    const char *name;
+    rlim_t unit;
+} kinds[RLIMITS_MAX] = {
+    {'c', RLIMIT_CORE, "core file size (KiB)", 1024},
+    {'n', RLIMIT_NOFILE, "open files", 1},
+    {'t', RLIMIT_CPU, "cpu time (seconds)", 1},
+    {'u', RLIMIT_NPROC, "max user processes", 1},
+    {'v', RLIMIT_AS, "virtual memory (KiB)", 1024},
+};
+
+/* finds the kind of limit option (e.g. "-v") is, returns -1 if none */
+static int find_kind(const char *option) {
+    if (option[0] != '-' || option[1] == '\0' || option[2] != '\0') {
+        return -1;
+    }
+    for (int k = 0; k < RLIMITS_MAX; k++) {
+        if (kinds[k].option == option[1]) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+/*
+ * records a limit given the way ulimit takes it: option is -c (core size,
+ * KiB), -n (open files), -t (CPU seconds), -u (processes) or -v (address
+ * space, KiB), and value a number or "unlimited"
+ * returns 0 on success, -1 if option is not one of those, -2 if value is bad
+ */
+int set_rlimit(rlimits_t *rlimits, const char *option, const char *value) {
+    int k = find_kind(option);
+    if (k == -1) {
+        return -1;
+    }
+
+    rlim_t limit;
+    if (strcmp(value, "unlimited") == 0) {
+        limit = RLIM_INFINITY;
+    } else {
+        char *end;
+        errno = 0;
+        unsigned long long n = strtoull(value, &end, 10);
+        if (value[0] < '0' || value[0] > '9' || *end != '\0' || errno != 0 ||
+            n > (unsigned long long)(RLIM_INFINITY - 1) / kinds[k].unit) {
+            return -2;
+        }
+        limit = (rlim_t)n * kinds[k].unit;
+    }
+
+    int i = 0;
+    while (i < rlimits->nlimits &&
+           rlimits->limits[i].resource != kinds[k].resource) {
+        i++;
+    }
+    rlimits->limits[i].resource = kinds[k].resource;
+    rlimits->limits[i].limit = limit;
+    if (i == rlimits->nlimits) {
+        rlimits->nlimits++;
+    }
+    return 0;
+}
+
+/*
+ * ulimit command, prints every limit jobs are launched with, those not set
+ * being the shell's own
+ * returns 0 on success, -1 on failure
+ */
+int print_rlimits(const rlimits_t *rlimits) {
+    for (int k = 0; k < RLIMITS_MAX; k++) {
+        struct rlimit own;
+        rlim_t limit = getrlimit(kinds[k].resource, &own) == 0 ? own.rlim_cur
+                                                               : RLIM_INFINITY;
+        for (int i = 0; i < rlimits->nlimits; i++) {
+            if (rlimits->limits[i].resource == kinds[k].resource) {
+                limit = rlimits->limits[i].limit;
+            }
+        }
+        int r =
+            limit == RLIM_INFINITY
+                ? printf("%-24s(-%c) unlimited\n", kinds[k].name,
+                         kinds[k].option)
+                : printf("%-24s(-%c) %llu\n", kinds[k].name, kinds[k].option,
+                         (unsigned long long)(limit / kinds[k].unit));
+        if (r < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef RLIMITS_H_
+#define RLIMITS_H_
+
+#include "./spawn.h"
+
+/* how many kinds of limit there are (see set_rlimit) */
+#define RLIMITS_MAX 5
+
+/*
+ * the resource limits jobs are launched with, on top of those the shell
+ * itself has: limits holds nlimits of them, at most one per resource, in the
+ * form a spawn plan takes them
+ * an empty set is all zeros, and a set can be copied by assignment (e.g. to
+ * add a command's own limits to the shell's)
+ */
+typedef struct {
+    spawn_limit_t limits[RLIMITS_MAX];
+    int nlimits;
+} rlimits_t;
+
+/*
+ * records a limit given the way ulimit takes it: option is -c (core size,
+ * KiB), -n (open files), -t (CPU seconds), -u (processes) or -v (address
+ * space, KiB), and value a number or "unlimited"
+ * returns 0 on success, -1 if option is not one of those, -2 if value is bad
+ */
+int set_rlimit(rlimits_t *rlimits, const char *option, const char *value);
+
+/*
+ * ulimit command, prints every limit jobs are launched with, those not set
+ * being the shell's own
+ * returns 0 on success, -1 on failure
+ */
+int print_rlimits(const rlimits_t *rlimits);
+
+#endif  // RLIMITS_H_
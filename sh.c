@@ -1,4 +1,5 @@
-#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -7,360 +8,272 @@
 #include <sys/file.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include "./affinity.h"
+#include "./arena.h"
+#include "./dirstack.h"
+#include "./events.h"
+#include "./history.h"
 #include "./jobs.h"
+#include "./linereader.h"
+#include "./pathcache.h"
+#include "./rlimits.h"
+#include "./spawn.h"
+#include "./vars.h"
 #include "childReaper.c"
 #include "parsing.c"
+#include "readCommand.c"
 #include "redirectsErrorChecker.c"
 #include "syntaxErrorChecker.c"
+#include "waitForeground.c"
 
-int main(void) {
-    /* TODO: everything! */
-    char buf[1024];
-    char *tokens[512];
-    char *argv[512];
-    int redirects[512];  // int array of redirect char indexes, excluding file
-    // destinations
+// these use the stage_t defined in parsing.c
+#include "launchPipeline.c"
+
+// the builtins run on the helpers above
+#include "builtins.c"
+
+// 33sh [-b] [script]: runs the commands in script if one is given, otherwise
+// reads them from stdin
+// -b reports background jobs as soon as they change state, rather than just
+// before the next prompt
+int main(int shellArgc, char **shellArgv) {
+    char *line;  // the command line being run
+    size_t len;
+    token_t *lexed;  // tokens of the command line
+    int ntokens;
+    stage_t *stages = NULL;  // parsed stages of the pipeline
+    int nstages;
+    char **tokens;  // tokens, argv, and argc of the first stage
+    char **argv;
     int argc;
-    ssize_t bytesRead = 1;
-    int fileIn;        // new input file
-    int fileOut;       // new output file
-    int filepath = 0;  // filepath index accounting for redirects
-    int background;    // background flag
-    int jid = 1;       // job id
-    int stdin_copy = dup(STDIN_FILENO);
-    int stdout_copy = dup(STDOUT_FILENO);
+    int background;     // background flag
+    int timed;          // whether the command is run under time
+    int first;          // first token of the command after its prefixes
+    int prefix;         // how many tokens a prefix takes
+    int assigns;        // how many variable assignments the command starts with
+    rlimits_t rlimits;  // the limits the command is launched with
+    placement_t placement;  // the CPUs and NUMA nodes it is launched on
+    char **envp = NULL;     // the environment it is launched with
     job_list_t *job_list = init_job_list();
+    path_cache_t *path_cache = init_path_cache();
+    dir_stack_t *dir_stack = init_dir_stack();
+    // the shell's variables start out as its environment, all exported
+    var_store_t *vars = init_var_store(environ);
+    if (vars == NULL) {
+        perror("Error allocating variables");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    // holds everything parsed from the command line being run
+    arena_t *arena = init_arena(4096);
+    if (arena == NULL) {
+        perror("Error allocating arena");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    const builtin_t *builtin;  // the builtin the command names, if any
+    // what builtins can act on: the next job is job 1, jobs are launched with
+    // no limits of their own, and the input is set once it is known
+    shell_t shell = {.job_list = job_list,
+                     .path_cache = path_cache,
+                     .dir_stack = dir_stack,
+                     .arena = arena,
+                     .jid = 1,
+                     .vars = vars};
+    if (initBuiltins() == -1) {
+        fprintf(stderr, "Error building builtin table\n");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    int arg = 1;  // first argument that is not an option
+    int notify = arg < shellArgc && strcmp(shellArgv[arg], "-b") == 0;
+    if (notify) arg++;
+    int script = arg < shellArgc;  // running a script rather than stdin
+    line_reader_t *reader = script ? init_line_reader_file(shellArgv[arg])
+                                   : init_line_reader(STDIN_FILENO);
+    if (reader == NULL) {
+        perror(shellArgv[arg]);
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    if (!script) shell.input = reader;
+    history_t *history = shell.history = openHistory(script);
+    // a script is read already, so there is no input to wait for
+    event_loop_t *events = script ? NULL : init_event_loop(STDIN_FILENO);
+    if (!script && events == NULL) {
+        perror("Error setting up event loop");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
     if (signal(SIGINT, SIG_IGN) ==
         SIG_ERR) {  // Ignore following signals when no foreground process
         perror("SIGINT ignore error.");
         cleanup_job_list(job_list);
-        exit(0);
+        exit(1);
     }
     if (signal(SIGTSTP, SIG_IGN) == SIG_ERR) {
         perror("SIGTSTP handler error.");
         cleanup_job_list(job_list);
-        exit(0);
+        exit(1);
     }
     if (signal(SIGTTOU, SIG_IGN) == SIG_ERR) {
         perror("SIGTTOU handler error.");
         cleanup_job_list(job_list);
-        exit(0);
+        exit(1);
     }
-    while (bytesRead > 0) {
-        childReaper(job_list);  // reap zombie processes
-#ifdef PROMPT
-        if (printf("33sh> ") < 0) {
-            cleanup_job_list(job_list);
-            exit(0);
-        }
-        if (fflush(stdout) < 0) {
+    while (1) {
+        reset_arena(arena);  // frees whatever the last line was parsed into
+        // PATH directories are checked for new commands once per line
+        next_path_generation(path_cache);
+        // reaps zombie processes, both now and while waiting for input
+        if ((line = readCommand(reader, events, notify, job_list, &len)) ==
+            NULL) {  // end of input
             cleanup_job_list(job_list);
             exit(0);
         }
-#endif
-        bytesRead = read(STDIN_FILENO, buf, sizeof(buf));
-        buf[bytesRead] = '\0';
-        if (bytesRead == -1) {
-            cleanup_job_list(job_list);
-            exit(0);
-        }
-        if (bytesRead == 0) {
-            cleanup_job_list(job_list);
-            exit(0);
+        // no command could be run from a longer line anyway, so the reader
+        // throws it away as it reads it
+        if (dropped_line(reader) > 0) {
+            if (fprintf(stderr, "syntax error: command line too long\n") < 0) {
+                perror("Error printing command line too long error");
+                cleanup_job_list(job_list);
+                exit(1);
+            }
+            continue;
         }
-        memset(tokens, '\0', 512 * 4);  // reset tokens, argv, and redirects
-        // every time we loop through
-        memset(argv, '\0', 512 * 4);
-        memset(redirects, -1,
-               512 * 4);  // redirects must be set to -1 due to overlap with
-        // possible redirect index values (e.g. 0)
-        argc = 0;        // reset argc
-        background = 0;  // reset background flag
-        parse(buf, tokens, argv, redirects);
-        while (argv[argc] != NULL) argc++;  // argv count set to argc
-        if (redirects[0] != -1) {           // checking for redirects
-            if (redirectsErrorChecker(tokens, redirects, argv, job_list) == -1)
+        // a line starting with '!' is one recalled from the history, which
+        // every line that is not blank is then added to
+        if (history != NULL) {
+            if ((line = recallHistory(history, line, &len, arena, job_list)) ==
+                NULL)
                 continue;
-            for (int j = 0; redirects[j] != -1; j++) {
-                if (strcmp(tokens[redirects[j]], "<") == 0) {
-                    if (close(STDIN_FILENO) < 0) {
-                        if (fprintf(stderr, "Error closing stdin\n") < 0) {
-                            perror("Error printing closing stdin error");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                    if ((fileIn = open(tokens[redirects[j] + 1], O_RDONLY)) <
-                        0) {
-                        dup2(stdin_copy, 0);
-                        if (fprintf(stderr,
-                                    "open: No such file or directory\n") < 0) {
-                            perror(
-                                "Error printing no such file or directory "
-                                "error");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                } else if (strcmp(tokens[redirects[j]], ">") == 0) {
-                    if (close(STDOUT_FILENO) < 0) {
-                        if (fprintf(stderr, "Error closing stdout\n") < 0) {
-                            perror("Error printing closing stdout error");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                    if ((fileOut = open(tokens[redirects[j] + 1],
-                                        O_RDWR | O_CREAT | O_TRUNC, 0777)) <
-                        0) {
-                        dup2(stdout_copy, 1);
-                        if (fprintf(stderr,
-                                    "open: No such file or directory\n") < 0) {
-                            perror("Error printing no such file or directory");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                } else if (strcmp(tokens[redirects[j]], ">>") == 0) {
-                    if (close(STDOUT_FILENO) < 0) {
-                        if (fprintf(stderr, "Error closing stdout\n") < 0) {
-                            perror("Error printing closing stdout error");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                    if ((fileOut = open(tokens[redirects[j] + 1],
-                                        O_RDWR | O_CREAT | O_APPEND, 0777)) <
-                        0) {
-                        dup2(stdout_copy, 1);
-                        if (fprintf(stderr,
-                                    "open: No such file or directory\n") < 0) {
-                            perror(
-                                "Error printing no such file or directory "
-                                "error");
-                            cleanup_job_list(job_list);
-                            exit(0);
-                        }
-                        break;
-                    }
-                }
+            if (line[strspn(line, " \t")] != '\0' &&
+                add_history(history, line, len) < 0)
+                perror("Error adding to history");
+        }
+        // the bodies of here-documents are read from the lines after this
+        // one, which can move it in the reader's buffer, so it is lexed from
+        // a copy instead
+        if (strstr(line, "<<") != NULL) {
+            char *copy = arena_alloc(arena, len + 1);
+            if (copy == NULL) {
+                perror("Error copying command line");
+                cleanup_job_list(job_list);
+                exit(1);
             }
+            line = memcpy(copy, line, len + 1);
         }
-        if (argc > 0 && strcmp(argv[argc - 1], "&") == 0) {  // checking for &
-            background = 1;         // set background process flag
-            argv[argc - 1] = NULL;  // remove & from command line
+        if ((ntokens = lex(line, &lexed, arena)) == -2 ||
+            (ntokens > 0 && readHereDocs(lexed, ntokens, reader, events, notify,
+                                         job_list, arena) == -1)) {
+            perror("Error allocating tokens");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-        if (!tokens[0])
-            continue;
-        else if (strcmp(tokens[0], "exit") == 0) {  // builtin command: exit
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            else {
+        if (ntokens == -1) {
+            if (fprintf(stderr, "syntax error: unterminated quote\n") < 0) {
+                perror("Error printing unterminated quote error");
                 cleanup_job_list(job_list);
-                exit(0);
+                exit(1);
             }
-        } else if (strcmp(tokens[0], "cd") == 0) {  // builtin command: cd
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            size_t l = strlen(argv[1]);
-            if (l > 0 && argv[1][l - 1] == '/') argv[1][l - 1] = '\0';
-            DIR *d = opendir(".");
-            if (d == NULL) {
-                perror("Error opening directory");
+            continue;
+        }
+        // run each command of the line in turn; a command ends at '&' (which
+        // runs it in the background) or ';', and one starting with the
+        // keyword time has its resource usage reported once it finishes. After
+        // that, variable assignments are either for the command alone or, with
+        // no command, for the shell, and ulimit and pin prefixes, in any order,
+        // launch it with limits and a placement of its own
+        for (int start = 0, end; start < ntokens; start = end + 1) {
+            end = commandEnd(lexed, ntokens, start);
+            timed = lexed[start].type == TOKEN_WORD &&
+                    strcmp(lexed[start].start, "time") == 0;
+            rlimits = shell.rlimits;
+            memset(&placement, 0, sizeof(placement));
+            first = start + timed;
+            // the command's words are only expanded now, so that they see the
+            // variables the commands before it set, but not its own
+            // assignments, which assignPrefix expands one at a time
+            for (assigns = 0;
+                 first + assigns < end && isAssignment(&lexed[first + assigns]);
+                 assigns++)
+                ;
+            if ((ntokens = expandWords(&lexed, ntokens, first + assigns, &end,
+                                       vars, shell.status, arena)) == -2) {
+                perror("Error expanding variables");
                 cleanup_job_list(job_list);
-                exit(0);
+                exit(1);
             }
-            int found = 0;
-            struct dirent *di;
-            while ((di = readdir(d)) != NULL) {
-                if (strcmp(di->d_name, argv[1]) == 0) {
-                    found = 1;
-                    break;
-                }
-            }
-            closedir(d);
-            if (found) {
-                if (chdir(argv[1]) != 0) {
-                    perror("Error changing directory");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-            } else {
-                if (fprintf(stderr, "%s: No such file or directory.\n",
-                            tokens[0]) < 0) {
-                    perror("Error printing no such file or directory error");
+            background = end < ntokens && lexed[end].type == TOKEN_AMP;
+            first += assignPrefix(lexed, first, end, &shell, &envp);
+            if (first == end && first > start + timed) continue;
+            do {
+                prefix = ulimitPrefix(lexed, first, end, &rlimits, job_list);
+                if (prefix == 0)
+                    prefix = pinPrefix(lexed, first, end, &placement, job_list);
+                if (prefix > 0) first += prefix;
+            } while (prefix > 0);
+            if (prefix == -1) continue;
+            nstages = parsePipeline(lexed + first, end - first, &stages, arena);
+            if (nstages == -1) {
+                if (fprintf(stderr, "syntax error: empty pipeline stage\n") <
+                    0) {
+                    perror("Error printing empty pipeline stage error");
                     cleanup_job_list(job_list);
-                    exit(0);
+                    exit(1);
                 }
                 continue;
             }
-        } else if (strcmp(tokens[0], "ln") == 0) {  // builtin command: ln
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            size_t l2 = strlen(argv[2]);
-            if (l2 > 0 && argv[2][l2 - 1] == '/') argv[1][l2 - 1] = '\0';
-            if (link(argv[1], argv[2]) < 0) {
-                if (fprintf(stderr, "%s: No such file or directory.\n",
-                            tokens[0]) < 0) {
-                    perror("Error printing no such file or directory error");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-                continue;
+            if (nstages == -2) {
+                perror("Error allocating pipeline");
+                cleanup_job_list(job_list);
+                exit(1);
             }
-        } else if (strcmp(tokens[0], "rm") == 0) {  // builtin command: rm
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            if (unlink(argv[1]) < 0) {
-                if (fprintf(stderr, "%s: No such file or directory.\n",
-                            tokens[0]) < 0) {
-                    perror("Error printing no such file or directory error");
+            if (nstages == 0) {
+                // a bare time times nothing, like bash's
+                struct rusage none = {0};
+                struct timespec zero = {0, 0};
+                if (timed && print_usage(&none, &zero) < 0) {
+                    perror("Error printing time");
                     cleanup_job_list(job_list);
-                    exit(0);
+                    exit(1);
                 }
                 continue;
             }
-        } else if (strcmp(tokens[0], "jobs") == 0) {  // builtin command: job
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            jobs(job_list);
-        } else if (strcmp(tokens[0], "bg") == 0) {  // builtin command: bg
-            int cur_pid;
-            int cur_jid;
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
-                continue;
-            else {
-                cur_jid = (int)strtol(argv[1] + 1, NULL, 10);
-                cur_pid = get_job_pid(job_list, cur_jid);
-                if (kill(-1 * cur_pid, SIGCONT) == 0) {
-                    update_job_pid(job_list, cur_pid, RUNNING);
-                } else {
-                    if (fprintf(stderr, "%s: kill error\n", tokens[0]) < 0) {
-                        perror("Error printing kill error");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
+            int redirectError = 0;
+            for (int i = 0; i < nstages; i++) {
+                if (stages[i].redirects[0] != -1 &&  // checking for redirects
+                    redirectsErrorChecker(&stages[i], job_list) == -1) {
+                    redirectError = 1;
+                    break;
                 }
             }
-        } else if (strcmp(tokens[0], "fg") == 0) {  // builtin command: fg
-            int cur_pid;
-            int cur_jid;
-            if (syntaxErrorChecker(tokens[0], argv, argc, job_list) == -1)
+            if (redirectError) continue;
+            tokens = stages[0].tokens;
+            argv = stages[0].argv;
+            argc = stages[0].argc;
+            if (!tokens[0])
                 continue;
-            else {
-                cur_jid = (int)strtol(argv[1] + 1, NULL, 10);
-                cur_pid = get_job_pid(job_list, cur_jid);
-                if (kill(-1 * cur_pid, SIGCONT) == -1) {
-                    if (fprintf(stderr, "%s: kill error\n", tokens[0]) < 0) {
-                        perror("Error printing kill error");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
-                }
-                int status;
-                tcsetpgrp(STDIN_FILENO, cur_pid);
-                waitpid(cur_pid, &status, WUNTRACED);
-                if (status == -1) {
-                    perror("Error waitpid");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                } else if (WIFEXITED(status)) {
-                    remove_job_pid(job_list, cur_pid);
-                } else if (WIFSIGNALED(status)) {
-                    if (printf("(%d) terminated by signal %d\n", cur_pid,
-                               WTERMSIG(status)) < 0) {
-                        perror("Error printing signal termination.");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
-                    remove_job_pid(job_list, cur_pid);
-                } else if (WIFSTOPPED(status)) {
-                    if (printf("[%d] (%d) suspended by signal %d\n", cur_jid,
-                               cur_pid, WSTOPSIG(status)) < 0) {
-                        perror("Error printing signal suspension.");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
-                    update_job_pid(job_list, cur_pid, STOPPED);
-                }
-                tcsetpgrp(STDIN_FILENO, getpgrp());
-            }
-        } else {
-            for (int i = 0; redirects[i] != -1;
-                 i++)  // getting command index while accounting for redirect
-                // chars
-                if (redirects[i] == 0) filepath += 2;
-            pid_t pid = fork();
-            if (!pid) {
-                setpgid(pid, getpid());
-                if (!background) {
-                    tcsetpgrp(STDIN_FILENO, getpgrp());
-                }
-                if (signal(SIGINT, SIG_DFL) == SIG_ERR) {
-                    perror("SIGINT child handler error.");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-                if (signal(SIGTSTP, SIG_DFL) == SIG_ERR) {
-                    perror("SIGTSTP child handler error.");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-                if (signal(SIGTTOU, SIG_DFL) == SIG_ERR) {
-                    perror("SIGTTOU child handler error.");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-                close(fileIn);
-                close(fileOut);
-                dup2(stdin_copy, STDIN_FILENO);
-                dup2(stdout_copy, STDOUT_FILENO);
-                execv(tokens[filepath], argv);
-                perror("execv");
-                cleanup_job_list(job_list);
-                exit(0);
-            }
-            if (background && tokens[filepath]) {
-                if (printf("[%d] (%d)\n", jid, pid) < 0) {
-                    perror("Error add job print");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                }
-                add_job(job_list, jid, pid, RUNNING, tokens[filepath]);
-                jid++;
-            } else if (!background) {
-                int status;
-                waitpid(pid, &status, WUNTRACED);
-                if (status == -1) {
-                    perror("Error waitpid");
-                    cleanup_job_list(job_list);
-                    exit(0);
-                } else if (WIFSIGNALED(status)) {
-                    if (printf("(%d) terminated by signal %d\n", pid,
-                               WTERMSIG(status)) < 0) {
-                        perror("Error printing signal termination.");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
-                } else if (WIFSTOPPED(status)) {
-                    add_job(job_list, jid, pid, STOPPED, tokens[filepath]);
-                    jid++;
-                    if (printf("[%d] (%d) suspended by signal %d\n",
-                               get_job_jid(job_list, pid), pid,
-                               WSTOPSIG(status)) < 0) {
-                        perror("Error printing signal suspension.");
-                        cleanup_job_list(job_list);
-                        exit(0);
-                    }
-                }
-                tcsetpgrp(STDIN_FILENO, getpgrp());
+            else if (nstages > 1)  // pipelines never run builtins
+                shell.jid =
+                    launchJob(stages, nstages, background, timed, &rlimits,
+                              &placement, envp, shell.jid, job_list, path_cache,
+                              arena, &shell.status);
+            else if ((builtin = findBuiltin(tokens[0])) != NULL) {
+                if (syntaxErrorChecker(tokens[0], argv, argc, builtin->minArgs,
+                                       builtin->maxArgs, builtin->rule,
+                                       job_list) == -1)
+                    continue;
+                if (timed)
+                    timeBuiltin(builtin, &shell, argv, argc);
+                else
+                    builtin->run(&shell, argv, argc);
+            } else {
+                shell.jid =
+                    launchJob(stages, nstages, background, timed, &rlimits,
+                              &placement, envp, shell.jid, job_list, path_cache,
+                              arena, &shell.status);
             }
         }
     }
-    return 0;
 }
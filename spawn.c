@@ -0,0 +1,165 @@
+#include "./spawn.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+
+// what the child is handed: the plan, and the signal mask to restore before it
+// execs (the parent blocks every signal while the child shares its memory)
+// the child's mask is the parent's without SIGCHLD, which the shell keeps
+// blocked for its signalfd but programs expect to start out unblocked
+struct child_args {
+    const spawn_plan_t *plan;
+    sigset_t mask;
+    sigset_t child_mask;
+};
+
+// stack the cloned child runs on until it execs; the parent is suspended until
+// then, so a single stack is enough
+static char child_stack[1 << 16] __attribute__((aligned(16)));
+
+/*
+ * reports a failure from the child as "<what>: <reason>" and exits with status
+ * 127, the way a shell reports a command it could not run
+ * the child shares the parent's memory after clone(CLONE_VM), stdio buffers
+ * included, so this only uses write(), and the reason comes from
+ * strerrordesc_np(), which returns a constant string rather than filling in a
+ * buffer of the parent's; err is the errno of the failure, saved by the caller
+ * before anything could change it
+ */
+static void __attribute__((noreturn)) child_fail(const char *what, int err) {
+    const char *reason = strerrordesc_np(err);
+    if (reason == NULL) reason = "Unknown error";
+    if (write(STDERR_FILENO, what, strlen(what)) < 0 ||
+        write(STDERR_FILENO, ": ", 2) < 0 ||
+        write(STDERR_FILENO, reason, strlen(reason)) < 0 ||
+        write(STDERR_FILENO, "\n", 1) < 0) {
+        _exit(127);
+    }
+    _exit(127);
+}
+
+/*
+ * runs in the child: joins the process group, takes the terminal if it is a
+ * foreground job, restores default signal behavior and applies its fd plan,
+ * closing every fd not in it, then pins itself to its CPUs and NUMA nodes,
+ * sets its resource limits and execs. Never returns: if something goes wrong
+ * it exits with status 127
+ */
+static int run_child(void *arg) {
+    struct child_args *args = (struct child_args *)arg;
+    const spawn_plan_t *plan = args->plan;
+
+    setpgid(0, plan->pgid);
+    if (plan->foreground) {
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    sigprocmask(SIG_SETMASK, &args->child_mask, NULL);
+
+    if (plan->in != -1) dup2(plan->in, STDIN_FILENO);
+    if (plan->out != -1) dup2(plan->out, STDOUT_FILENO);
+    int planned = 07;  // bit per fd the child is meant to have open
+    for (int i = 0; i < plan->nredirects; i++) {
+        const spawn_redirect_t *r = &plan->redirects[i];
+        if (r->path == NULL) {
+            if (!r->shell && !(planned & (1 << r->from))) {
+                char name[2] = {(char)('0' + r->from), '\0'};
+                child_fail(name, EBADF);
+            }
+            dup2(r->from, r->fd);
+        } else {
+            int fd = open(r->path, r->flags, 0777);
+            if (fd < 0) {
+                child_fail("open", errno);
+            }
+            if (fd != r->fd) {
+                dup2(fd, r->fd);
+                close(fd);
+            }
+        }
+        planned |= 1 << r->fd;
+    }
+    // the shell's own fds are all close-on-exec, but sweep up anything else
+    // that is not part of the plan, e.g. from a library or the shell's parent
+    for (int fd = 3; fd <= SPAWN_MAX_FD; fd++) {
+        if (!(planned & (1 << fd))) close(fd);
+    }
+    close_range(SPAWN_MAX_FD + 1, ~0U, 0);
+    if (plan->cpus != NULL &&
+        sched_setaffinity(0, sizeof(cpu_set_t), plan->cpus) < 0) {
+        child_fail("sched_setaffinity", errno);
+    }
+    // the policy is the child's own (the memory it shares with the shell is
+    // not touched), and it is kept across execve; one more bit is passed than
+    // the mask has, the way set_mempolicy() counts them
+    if (plan->mem_nodes != 0 &&
+        syscall(SYS_set_mempolicy, MPOL_BIND, &plan->mem_nodes,
+                sizeof(plan->mem_nodes) * 8 + 1) < 0) {
+        child_fail("set_mempolicy", errno);
+    }
+    for (int i = 0; i < plan->nlimits; i++) {
+        struct rlimit limit = {plan->limits[i].limit, plan->limits[i].limit};
+        if (setrlimit(plan->limits[i].resource, &limit) < 0) {
+            child_fail("setrlimit", errno);
+        }
+    }
+    execve(plan->path, plan->argv, plan->envp ? plan->envp : environ);
+    child_fail("execve", errno);
+}
+
+/* blocks every signal, creates the child one way or the other, then restores
+ * the signal mask and makes sure the child is in its process group */
+static pid_t spawn_with(const spawn_plan_t *plan, int use_fork) {
+    struct child_args args;
+    sigset_t all;
+    pid_t pid;
+
+    args.plan = plan;
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &args.mask);
+    args.child_mask = args.mask;
+    sigdelset(&args.child_mask, SIGCHLD);
+    if (plan->pidfd != NULL) *plan->pidfd = -1;
+    if (use_fork) {
+        if ((pid = fork()) == 0) {
+            _exit(run_child(&args));
+        }
+        if (pid > 0 && plan->pidfd != NULL) {
+            *plan->pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+        }
+    } else {
+        pid = clone(run_child, child_stack + sizeof(child_stack),
+                    CLONE_VM | CLONE_VFORK | SIGCHLD |
+                        (plan->pidfd != NULL ? CLONE_PIDFD : 0),
+                    &args, plan->pidfd);
+    }
+    int err = errno;
+    sigprocmask(SIG_SETMASK, &args.mask, NULL);
+    if (pid > 0) {
+        // also done in the child; whichever runs first wins
+        setpgid(pid, plan->pgid ? plan->pgid : pid);
+    }
+    errno = err;
+    return pid;
+}
+
+/*
+ * launches a child as described by plan, returns its PID, -1 on failure
+ * the child is created with clone(CLONE_VM | CLONE_VFORK), so no page tables
+ * are copied and this returns once the child has exec'd (or given up)
+ * the pidfd, if asked for, comes from CLONE_PIDFD
+ */
+pid_t spawn_process(const spawn_plan_t *plan) { return spawn_with(plan, 0); }
+
+/*
+ * same as spawn_process, but creates the child with fork(), and the pidfd with
+ * pidfd_open()
+ * kept so the two can be compared (see bench/spawnBench.c)
+ */
+pid_t spawn_fork(const spawn_plan_t *plan) { return spawn_with(plan, 1); }
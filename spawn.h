@@ -0,0 +1,85 @@
+#ifndef SPAWN_H_
+#define SPAWN_H_
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*
+ * one step of the child's fd plan: the file path, opened with flags, is put on
+ * fd, or with path NULL, fd is made a copy of from
+ * fds are numbered 0 to SPAWN_MAX_FD; from must be 0, 1, 2 or an fd an earlier
+ * step put in place, since nothing else the shell has open is the child's,
+ * unless shell is set: then from is an fd the shell opened for the child (such
+ * as the body of a here-document)
+ */
+typedef struct {
+    const char *path;
+    int flags;
+    int fd;
+    int from;
+    int shell;
+} spawn_redirect_t;
+
+/*
+ * a resource limit the child sets on itself (both soft and hard) before it
+ * execs, e.g. RLIMIT_AS
+ */
+typedef struct {
+    int resource;
+    rlim_t limit;
+} spawn_limit_t;
+
+/* highest fd a redirect can name */
+#define SPAWN_MAX_FD 9
+
+/*
+ * everything the child needs to set up before it execs path
+ * pgid: process group to join, 0 to lead a new one
+ * foreground: whether the child takes the terminal
+ * in, out: fds to put on stdin/stdout (e.g. pipe ends), -1 for none
+ * redirects: the fd plan, applied in order after in and out have been put in
+ * place; every other fd above 2 is closed before the child execs
+ * cpus: CPUs to pin the child to, NULL to leave its affinity alone
+ * mem_nodes: NUMA nodes (a bit per node) to bind the child's memory to, 0 for
+ * no binding
+ * limits: resource limits to set, applied last, so a limit on open files
+ * does not get in the way of the fd plan
+ * envp: the environment to exec with, NULL for the shell's own
+ * pidfd: where to store a pidfd for the child, NULL for none; -1 is stored if
+ * there is none to be had
+ */
+typedef struct {
+    const char *path;
+    char *const *argv;
+    pid_t pgid;
+    int foreground;
+    int in;
+    int out;
+    const spawn_redirect_t *redirects;
+    int nredirects;
+    const cpu_set_t *cpus;
+    unsigned long mem_nodes;
+    const spawn_limit_t *limits;
+    int nlimits;
+    char *const *envp;
+    int *pidfd;
+} spawn_plan_t;
+
+/*
+ * launches a child as described by plan, returns its PID, -1 on failure
+ * the child is created with clone(CLONE_VM | CLONE_VFORK), so no page tables
+ * are copied and this returns once the child has exec'd (or given up)
+ * the pidfd, if asked for, comes from CLONE_PIDFD
+ */
+pid_t spawn_process(const spawn_plan_t *plan);
+
+/*
+ * same as spawn_process, but creates the child with fork(), and the pidfd with
+ * pidfd_open()
+ * kept so the two can be compared (see bench/spawnBench.c)
+ */
+pid_t spawn_fork(const spawn_plan_t *plan);
+
+#endif  // SPAWN_H_
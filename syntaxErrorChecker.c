@@ -3,90 +3,217 @@
 #include <stdlib.h>
 #include <string.h>
 
-// For the given command, we check for syntax errors and return -1 if we have
-// any, otherwise we return 0
-int syntaxErrorChecker(char *command, char *argv[512], int argc,
-                       job_list_t *job_list) {
-    if (strcmp(command, "fg") == 0 ||
-        strcmp(command, "bg") == 0) {  // builtin command: fg and bg
-        if (argc != 2) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing fg syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+// A syntax rule a builtin has on top of how many arguments it takes. Returns
+// -1 (having printed why) if argv breaks it, 0 otherwise
+typedef int (*syntax_rule_t)(char *command, char **argv, int argc,
+                             job_list_t *job_list);
+
+// fg and bg: the argument is %<jid> of a job that exists
+int jobIdRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    (void)argc;
+    if (argv[1][0] != '%') {
+        if (fprintf(stderr, "%s: syntax error; need %%\n", command) < 0) {
+            perror("Error printing fg syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-        if (argv[1][0] != '%') {
-            if (fprintf(stderr, "%s: syntax error; need %%\n", command) < 0) {
-                perror("Error printing fg syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+        return -1;
+    }
+    if (get_job_pid(job_list, (int)strtol(argv[1] + 1, NULL, 10)) == -1) {
+        if (fprintf(stderr, "%s: invalid job id\n", command) < 0) {
+            perror("Error printing invalid job id error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-        if (get_job_pid(job_list, (int)strtol(argv[1] + 1, NULL, 10)) == -1) {
-            if (fprintf(stderr, "%s: invalid job id\n", command) < 0) {
-                perror("Error printing invalid job id error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+        return -1;
+    }
+    return 0;
+}
+
+// wait: -n, if given, comes first, and every other argument is %<jid> of a job
+// that exists
+int waitRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    for (int i = argc > 1 && strcmp(argv[1], "-n") == 0 ? 2 : 1; i < argc;
+         i++) {
+        // jobIdRule checks the argument after the command
+        if (jobIdRule(command, argv + i - 1, 2, job_list) == -1) return -1;
+    }
+    return 0;
+}
+
+// history: either a number of lines above 0, or -s and the text to search for
+int historyRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    char *end = NULL;
+    if ((argc == 2 && (strtol(argv[1], &end, 10) < 1 || *end != '\0')) ||
+        (argc == 3 && strcmp(argv[1], "-s") != 0)) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing history syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-    } else if (strcmp(command, "jobs") == 0) {  // builtin command: job
-        if (argc != 1) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing jobs syntax error");
+        return -1;
+    }
+    return 0;
+}
+
+// export and unset: every argument is a variable name; export's can also be
+// NAME=value
+int exportRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    for (int i = 1; i < argc; i++) {
+        char *eq = strchr(argv[i], '=');
+        size_t len = eq && strcmp(command, "export") == 0
+                         ? (size_t)(eq - argv[i])
+                         : strlen(argv[i]);
+        if (!valid_var_name(argv[i], len)) {
+            if (fprintf(stderr, "%s: %s: not a valid name\n", command,
+                        argv[i]) < 0) {
+                perror("Error printing variable name error");
                 cleanup_job_list(job_list);
                 exit(1);
             }
             return -1;
         }
-    } else if (strcmp(command, "cd") == 0) {  // builtin command: cd
-        if (argc != 2) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing cd syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+    }
+    return 0;
+}
+
+// hash: the only option is -r
+int hashRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    if (argc == 2 && strcmp(argv[1], "-r") != 0) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing hash syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-    } else if (strcmp(command, "rm") == 0) {  // builtin command: rm
-        if (argc != 2) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing rm syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+        return -1;
+    }
+    return 0;
+}
+
+// jobs: the only option is -l
+int jobsRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    if (argc == 2 && strcmp(argv[1], "-l") != 0) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing jobs syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-    } else if (strcmp(command, "ln") == 0) {  // builtin command: ln
-        if (argc != 3) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing ln syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Adds the limit given by option and value (NULL if it is missing) to rlimits,
+// the way ulimit takes them. Returns -1 (having printed why) if either is bad,
+// 0 otherwise
+int addLimit(char *command, char *option, char *value, rlimits_t *rlimits,
+             job_list_t *job_list) {
+    int r = value == NULL ? -1 : set_rlimit(rlimits, option, value);
+    if (r != 0) {
+        if ((r == -1 ? fprintf(stderr, "%s: syntax error\n", command)
+                     : fprintf(stderr, "%s: %s: invalid limit\n", command,
+                               value)) < 0) {
+            perror("Error printing ulimit error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-        size_t l1 = strlen(argv[1]);
-        if (l1 > 0 && argv[1][l1 - 1] == '/') {
-            if (fprintf(stderr, "%s: Not a directory\n", command) < 0) {
-                perror("Error printing not a directory error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
+        return -1;
+    }
+    return 0;
+}
+
+// ulimit: options come with their limits, and are ones set_rlimit takes
+int ulimitRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    rlimits_t scratch = {{{0, 0}}, 0};
+    for (int i = 1; i < argc; i += 2) {
+        if (addLimit(command, argv[i], i + 1 < argc ? argv[i + 1] : NULL,
+                     &scratch, job_list) == -1)
             return -1;
+    }
+    return 0;
+}
+
+// Sets placement from cpus and nodes (NULL for none), the way pin takes them.
+// Returns -1 (having printed why) if either is bad, 0 otherwise
+int addPlacement(char *command, char *cpus, char *nodes, placement_t *placement,
+                 job_list_t *job_list) {
+    int r = set_placement(placement, cpus, nodes);
+    if (r != 0) {
+        if (fprintf(stderr, "%s: %s: invalid %s list\n", command,
+                    r == -1 ? cpus : nodes, r == -1 ? "cpu" : "node") < 0) {
+            perror("Error printing pin error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
-    } else if (strcmp(command, "exit") == 0) {  // builtin command: exit
-        if (argc != 1) {
-            if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
-                perror("Error printing exit syntax error");
-                cleanup_job_list(job_list);
-                exit(1);
-            }
-            return -1;
+        return -1;
+    }
+    return 0;
+}
+
+// pin: %<jid> of a job that exists, a CPU list, then optionally --mem and a
+// node list
+int pinRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    placement_t scratch;
+    if (jobIdRule(command, argv, argc, job_list) == -1) return -1;
+    if (argc == 5 && strcmp(argv[3], "--mem") != 0) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing pin syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
         }
+        return -1;
+    }
+    return addPlacement(command, argv[2], argc == 5 ? argv[4] : NULL, &scratch,
+                        job_list);
+}
+
+// parallel: -j, if given, comes with a number of jobs above 0, and there is a
+// template to run
+int parallelRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    int t = 1;  // where the template starts
+    if (strcmp(argv[1], "-j") == 0) {
+        char *end;
+        t = 3;
+        if (argc < 3 || strtol(argv[2], &end, 10) < 1 || *end != '\0') t = argc;
+    }
+    if (t >= argc || strcmp(argv[t], ":::") == 0) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing parallel syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// ln: the file being linked to is not given as a directory
+int linkRule(char *command, char **argv, int argc, job_list_t *job_list) {
+    (void)argc;
+    size_t l1 = strlen(argv[1]);
+    if (l1 > 0 && argv[1][l1 - 1] == '/') {
+        if (fprintf(stderr, "%s: Not a directory\n", command) < 0) {
+            perror("Error printing not a directory error");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        return -1;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+// For the given builtin, which takes minArgs to maxArgs words (counting its
+// name) and follows rule (NULL for none), we check for syntax errors and
+// return -1 if we have any, otherwise we return 0
+int syntaxErrorChecker(char *command, char **argv, int argc, int minArgs,
+                       int maxArgs, syntax_rule_t rule, job_list_t *job_list) {
+    if (argc < minArgs || argc > maxArgs) {
+        if (fprintf(stderr, "%s: syntax error\n", command) < 0) {
+            perror("Error printing syntax error");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        return -1;
+    }
+    return rule == NULL ? 0 : rule(command, argv, argc, job_list);
+}
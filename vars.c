@@ -0,0 +1,327 @@
+#include "./vars.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// buckets in the table to start with, a power of two
+#define VAR_BUCKETS 64
+
+// a variable, kept as a single "NAME=value" string so that an environment
+// can point right at it; name_len is the length of NAME, and a free bucket
+// has entry NULL
+struct var {
+    char *entry;
+    size_t name_len;
+    int exported;
+};
+typedef struct var var_t;
+
+// vars is an open addressing hash table of size buckets (a power of two), of
+// which count are in use, nexported of them exported
+// envp is the environment last built from the exported variables, and dirty
+// is set when one of them has changed since
+struct var_store {
+    var_t *vars;
+    size_t size;
+    size_t count;
+    size_t nexported;
+    char **envp;
+    int dirty;
+};
+
+/* FNV-1a hash of the len bytes of a name */
+static size_t hash_var(const char *name, size_t len) {
+    size_t h = 14695981039346656037UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/* finds the bucket holding the variable name, or the free bucket where it
+ * would go */
+static var_t *find_var(var_t *vars, size_t size, const char *name, size_t len) {
+    size_t i = hash_var(name, len) & (size - 1);
+    while (vars[i].entry != NULL &&
+           (vars[i].name_len != len || memcmp(vars[i].entry, name, len) != 0)) {
+        i = (i + 1) & (size - 1);
+    }
+    return &vars[i];
+}
+
+/* whether the len bytes at name make a variable name: a letter or '_', then
+ * letters, digits and '_' */
+int valid_var_name(const char *name, size_t len) {
+    if (len == 0 || (name[0] >= '0' && name[0] <= '9')) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9'))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * puts entry ("NAME=value", which the store takes over) in the table, in
+ * place of any variable of the same name, growing the table when it is half
+ * full; the variable is exported if export is set or it already was
+ * returns 0 on success, -1 on failure
+ */
+static int put_var(var_store_t *var_store, char *entry, int export) {
+    size_t len = (size_t)(strchr(entry, '=') - entry);
+    if ((var_store->count + 1) * 2 > var_store->size) {
+        size_t size = var_store->size * 2;
+        var_t *vars = (var_t *)calloc(size, sizeof(var_t));
+        if (vars == NULL) {
+            return -1;
+        }
+        for (size_t i = 0; i < var_store->size; i++) {
+            var_t *v = &var_store->vars[i];
+            if (v->entry != NULL) {
+                *find_var(vars, size, v->entry, v->name_len) = *v;
+            }
+        }
+        free(var_store->vars);
+        var_store->vars = vars;
+        var_store->size = size;
+    }
+    var_t *v = find_var(var_store->vars, var_store->size, entry, len);
+    if (v->entry == NULL) {
+        var_store->count++;
+        v->exported = 0;
+    } else {
+        free(v->entry);
+    }
+    v->entry = entry;
+    v->name_len = len;
+    if (export && !v->exported) {
+        v->exported = 1;
+        var_store->nexported++;
+    }
+    if (v->exported) {
+        var_store->dirty = 1;
+    }
+    return 0;
+}
+
+/*
+ * initializes a variable store holding the variables of env (an environ-style
+ * array), all of them exported, returns pointer, NULL on failure
+ */
+var_store_t *init_var_store(char **env) {
+    var_store_t *var_store = (var_store_t *)malloc(sizeof(var_store_t));
+    if (var_store == NULL) {
+        return NULL;
+    }
+    var_store->size = VAR_BUCKETS;
+    var_store->vars = (var_t *)calloc(var_store->size, sizeof(var_t));
+    var_store->count = 0;
+    var_store->nexported = 0;
+    var_store->envp = NULL;
+    var_store->dirty = 1;
+    if (var_store->vars == NULL) {
+        free(var_store);
+        return NULL;
+    }
+    for (char **e = env; *e != NULL; e++) {
+        char *eq = strchr(*e, '=');
+        char *entry;
+        if (eq == NULL || !valid_var_name(*e, (size_t)(eq - *e))) {
+            continue;  // nothing a variable could be made of
+        }
+        if ((entry = strdup(*e)) == NULL || put_var(var_store, entry, 1) < 0) {
+            free(entry);
+            cleanup_var_store(var_store);
+            return NULL;
+        }
+    }
+    return var_store;
+}
+
+/*
+ * cleans up variable store
+ * Note: this function will free the var_store pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_var_store(var_store_t *var_store) {
+    for (size_t i = 0; i < var_store->size; i++) {
+        free(var_store->vars[i].entry);
+    }
+    free(var_store->vars);
+    free(var_store->envp);
+    free(var_store);
+}
+
+/*
+ * gets the value of the variable whose name is the len bytes at name
+ * returns the value, NULL if the variable is not set
+ */
+const char *get_var(var_store_t *var_store, const char *name, size_t len) {
+    var_t *v = find_var(var_store->vars, var_store->size, name, len);
+    return v->entry == NULL ? NULL : v->entry + len + 1;
+}
+
+/*
+ * sets a variable, keeping whether it is exported, or exporting it if export
+ * is set
+ * exported variables are also set in the shell's own environment, so that
+ * getenv() (e.g. for PATH) sees them
+ * returns 0 on success, -1 on failure
+ */
+int set_var(var_store_t *var_store, const char *name, const char *value,
+            int export) {
+    size_t len = strlen(name), value_len = strlen(value);
+    char *entry = (char *)malloc(len + value_len + 2);
+    if (entry == NULL) {
+        return -1;
+    }
+    memcpy(entry, name, len);
+    entry[len] = '=';
+    memcpy(entry + len + 1, value, value_len + 1);
+    if (put_var(var_store, entry, export) < 0) {
+        free(entry);
+        return -1;
+    }
+    if (find_var(var_store->vars, var_store->size, name, len)->exported) {
+        return setenv(name, value, 1);
+    }
+    return 0;
+}
+
+/*
+ * exports a variable, given its name; one that is not set is set to ""
+ * returns 0 on success, -1 on failure
+ */
+int export_var(var_store_t *var_store, const char *name) {
+    const char *value = get_var(var_store, name, strlen(name));
+    char *copy = strdup(value == NULL ? "" : value);
+    if (copy == NULL) {
+        return -1;
+    }
+    int r = set_var(var_store, name, copy, 1);
+    free(copy);
+    return r;
+}
+
+/* unsets a variable, given its name, returns 0 (whether or not it was set) */
+int unset_var(var_store_t *var_store, const char *name) {
+    size_t len = strlen(name);
+    var_t *v = find_var(var_store->vars, var_store->size, name, len);
+    if (v->entry == NULL) {
+        return 0;
+    }
+    if (v->exported) {
+        var_store->nexported--;
+        var_store->dirty = 1;
+        unsetenv(name);
+    }
+    free(v->entry);
+    v->entry = NULL;
+    var_store->count--;
+    // shift back any variables that probed past the freed bucket
+    size_t i = (size_t)(v - var_store->vars), j = i;
+    while (1) {
+        j = (j + 1) & (var_store->size - 1);
+        var_t *w = &var_store->vars[j];
+        if (w->entry == NULL) {
+            return 0;
+        }
+        size_t home = hash_var(w->entry, w->name_len) & (var_store->size - 1);
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && home <= i && home > j)) {
+            var_store->vars[i] = *w;
+            w->entry = NULL;
+            i = j;
+        }
+    }
+}
+
+/*
+ * gets the environment to launch commands with: a NULL terminated array of
+ * "NAME=value" strings, one for each exported variable
+ * the array is only rebuilt when an exported variable has changed since it was
+ * last asked for, and its strings are the variables' own, never copied
+ * returns the array, NULL on failure; it is valid until a variable changes
+ */
+char **get_envp(var_store_t *var_store) {
+    if (!var_store->dirty) {
+        return var_store->envp;
+    }
+    char **envp = (char **)realloc(var_store->envp,
+                                   sizeof(char *) * (var_store->nexported + 1));
+    if (envp == NULL) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < var_store->size; i++) {
+        if (var_store->vars[i].entry != NULL && var_store->vars[i].exported) {
+            envp[n++] = var_store->vars[i].entry;
+        }
+    }
+    envp[n] = NULL;
+    var_store->envp = envp;
+    var_store->dirty = 0;
+    return envp;
+}
+
+/*
+ * gets the environment for one command that has variable assignments of its
+ * own: get_envp(), with the n "NAME=value" strings in assigns added or taking
+ * the place of the variables of the same name
+ * the array is allocated from arena
+ * returns the array, NULL on failure
+ */
+char **get_envp_with(var_store_t *var_store, char **assigns, int n,
+                     arena_t *arena) {
+    char **base = get_envp(var_store);
+    char **envp = (char **)arena_alloc(
+        arena, sizeof(char *) * (var_store->nexported + (size_t)n + 1));
+    if (base == NULL || envp == NULL) {
+        return NULL;
+    }
+    size_t count = 0;
+    for (char **e = base; *e != NULL; e++) {
+        size_t len = (size_t)(strchr(*e, '=') - *e);
+        int overridden = 0;
+        for (int a = 0; a < n && !overridden; a++) {
+            overridden = strncmp(assigns[a], *e, len + 1) == 0;
+        }
+        if (!overridden) {
+            envp[count++] = *e;
+        }
+    }
+    for (int a = 0; a < n; a++) {
+        // a later assignment to the same name wins
+        size_t len = (size_t)(strchr(assigns[a], '=') - assigns[a]);
+        int later = 0;
+        for (int b = a + 1; b < n && !later; b++) {
+            later = strncmp(assigns[a], assigns[b], len + 1) == 0;
+        }
+        if (!later) {
+            envp[count++] = assigns[a];
+        }
+    }
+    envp[count] = NULL;
+    return envp;
+}
+
+/*
+ * export command, prints every exported variable as export NAME="value"
+ * returns 0 on success, -1 on failure
+ */
+int print_exported(var_store_t *var_store) {
+    for (size_t i = 0; i < var_store->size; i++) {
+        var_t *v = &var_store->vars[i];
+        if (v->entry != NULL && v->exported &&
+            printf("export %.*s=\"%s\"\n", (int)v->name_len, v->entry,
+                   v->entry + v->name_len + 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef VARS_H_
+#define VARS_H_
+
+#include <stddef.h>
+#include "./arena.h"
+
+typedef struct var_store var_store_t;
+
+/*
+ * initializes a variable store holding the variables of env (an environ-style
+ * array), all of them exported, returns pointer, NULL on failure
+ */
+var_store_t *init_var_store(char **env);
+/*
+ * cleans up variable store
+ * Note: this function will free the var_store pointer
+ * DO NOT use the pointer after this function is called
+ */
+void cleanup_var_store(var_store_t *var_store);
+
+/* whether the len bytes at name make a variable name: a letter or '_', then
+ * letters, digits and '_' */
+int valid_var_name(const char *name, size_t len);
+
+/*
+ * gets the value of the variable whose name is the len bytes at name
+ * returns the value, NULL if the variable is not set
+ */
+const char *get_var(var_store_t *var_store, const char *name, size_t len);
+
+/*
+ * sets a variable, keeping whether it is exported, or exporting it if export
+ * is set
+ * exported variables are also set in the shell's own environment, so that
+ * getenv() (e.g. for PATH) sees them
+ * returns 0 on success, -1 on failure
+ */
+int set_var(var_store_t *var_store, const char *name, const char *value,
+            int export);
+/*
+ * exports a variable, given its name; one that is not set is set to ""
+ * returns 0 on success, -1 on failure
+ */
+int export_var(var_store_t *var_store, const char *name);
+/* unsets a variable, given its name, returns 0 (whether or not it was set) */
+int unset_var(var_store_t *var_store, const char *name);
+
+/*
+ * gets the environment to launch commands with: a NULL terminated array of
+ * "NAME=value" strings, one for each exported variable
+ * the array is only rebuilt when an exported variable has changed since it was
+ * last asked for, and its strings are the variables' own, never copied
+ * returns the array, NULL on failure; it is valid until a variable changes
+ */
+char **get_envp(var_store_t *var_store);
+/*
+ * gets the environment for one command that has variable assignments of its
+ * own: get_envp(), with the n "NAME=value" strings in assigns added or taking
+ * the place of the variables of the same name
+ * the array is allocated from arena
+ * returns the array, NULL on failure
+ */
+char **get_envp_with(var_store_t *var_store, char **assigns, int n,
+                     arena_t *arena);
+
+/*
+ * export command, prints every exported variable as export NAME="value"
+ * returns 0 on success, -1 on failure
+ */
+int print_exported(var_store_t *var_store);
+
+#endif  // VARS_H_
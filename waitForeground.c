@@ -0,0 +1,66 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "jobs.h"
+
+// Waits on the foreground job with the given JID until every process in it has
+// either finished or been suspended, then hands the terminal back to the
+// shell. Each member is waited on in turn through its pidfd, so the wait can
+// only ever be for that very process. The resource usage of each member that
+// finishes is added to the job's, and reported if the job is timed. The status
+// of the last member (its exit status, or 128 plus the signal that killed or
+// suspended it) is stored in *status. Returns 1 if the job was suspended and so
+// stays on the job list, 0 if it finished and was removed from it
+int waitForeground(job_list_t *job_list, int jid, int *status) {
+    pid_t pgid = get_job_pid(job_list, jid);
+    int stopsig = 0;  // signal that suspended the last member
+    int i = 0;        // member being waited on; those before it are suspended
+    int pidfd;
+    pid_t pid;
+    siginfo_t info;
+    struct rusage usage;
+    while ((pid = get_job_member(job_list, jid, i, &pidfd)) > 0) {
+        if ((pidfd >= 0 ? waitUsage(P_PIDFD, (id_t)pidfd, &info,
+                                    WEXITED | WSTOPPED, &usage)
+                        : waitUsage(P_PID, (id_t)pid, &info, WEXITED | WSTOPPED,
+                                    &usage)) < 0) {
+            if (errno == EINTR) continue;
+            perror("Error waitid");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        if (info.si_code == CLD_STOPPED || info.si_code == CLD_TRAPPED) {
+            update_job_member(job_list, pid, STOPPED);
+            stopsig = info.si_status;
+            *status = 128 + stopsig;
+            i++;
+            continue;
+        }
+        if (info.si_code != CLD_EXITED &&
+            printf("(%d) terminated by signal %d\n", pid, info.si_status) < 0) {
+            perror("Error printing signal termination.");
+            cleanup_job_list(job_list);
+            exit(1);
+        }
+        *status =
+            info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+        add_job_usage(job_list, pid, &usage);
+        remove_job_member(job_list, pid);
+    }
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+    if (i == 0) {
+        fflush(stdout);  // anything the job's report follows goes out first
+        report_job_usage(job_list, jid);
+        remove_job_jid(job_list, jid);
+        return 0;
+    }
+    if (printf("[%d] (%d) suspended by signal %d\n", jid, pgid, stopsig) < 0) {
+        perror("Error printing signal suspension.");
+        cleanup_job_list(job_list);
+        exit(1);
+    }
+    update_job_jid(job_list, jid, STOPPED);
+    return 1;
+}